@@ -73,6 +73,7 @@
 #include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/date.h"
+#include "utils/datetime.h"
 #include "utils/datum.h"
 #include "utils/expandedrecord.h"
 #include "utils/json.h"
@@ -81,6 +82,7 @@
 #include "utils/jsonpath.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/numeric.h"
 #include "utils/resowner.h"
 #include "utils/timestamp.h"
 #include "utils/typcache.h"
@@ -4617,7 +4619,8 @@ EvalJsonPathVar(void *cxt, char *varName, int varNameLen,
 	{
 		var = lfirst(lc);
 
-		if (!strncmp(var->name, varName, varNameLen))
+		if (strlen(var->name) == varNameLen &&
+			!strncmp(var->name, varName, varNameLen))
 			break;
 
 		var = NULL;
@@ -4635,6 +4638,10 @@ EvalJsonPathVar(void *cxt, char *varName, int varNameLen,
 		var->value = ExecEvalExpr(var->estate, var->econtext, &var->isnull);
 		var->evaluated = true;
 
+		/* Convert the value only once, it may be referenced many times */
+		if (!var->isnull)
+			JsonItemFromDatum(var->value, var->typid, var->typmod, &var->jbv);
+
 		if (oldcxt)
 			MemoryContextSwitchTo(oldcxt);
 	}
@@ -4645,8 +4652,7 @@ EvalJsonPathVar(void *cxt, char *varName, int varNameLen,
 		return 0;
 	}
 
-	JsonItemFromDatum(var->value, var->typid, var->typmod, val);
-
+	*val = var->jbv;
 	*baseObject = *val;
 	return id;
 }
@@ -4743,6 +4749,115 @@ ExecPrepareJsonItemCoercion(JsonbValue *item,
 	return res;
 }
 
+/*
+ * Try to convert a scalar SQL/JSON item directly to some common built-in
+ * output types, skipping the evaluation of the coercion expression, which
+ * would call a cast function or go through the text representation of the
+ * item.  Integral numbers are converted to integer and float8 types, and
+ * strings in the ISO format to date and timestamp types.
+ *
+ * Returns false if the conversion is not handled here, including the cases
+ * when the coercion might raise an error or round the value, so that the
+ * caller coerces the item the usual way with the same result.
+ */
+static bool
+ExecJsonItemDirectCoercion(JsonbValue *item, JsonReturning *returning,
+						   Datum *res)
+{
+	int64		val;
+	struct pg_tm tt,
+			   *tm = &tt;
+	fsec_t		fsec;
+	bool		has_time;
+	bool		has_tz;
+	int			tz;
+
+	/* the coercions below do not apply typmods */
+	if (returning->typmod >= 0)
+		return false;
+
+	switch (returning->typid)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case FLOAT8OID:
+			if (item->type != jbvNumeric ||
+				!numeric_get_int64(item->val.numeric, &val))
+				return false;
+
+			switch (returning->typid)
+			{
+				case INT2OID:
+					if (val < PG_INT16_MIN || val > PG_INT16_MAX)
+						return false;
+					*res = Int16GetDatum((int16) val);
+					return true;
+
+				case INT4OID:
+					if (val < PG_INT32_MIN || val > PG_INT32_MAX)
+						return false;
+					*res = Int32GetDatum((int32) val);
+					return true;
+
+				case INT8OID:
+					*res = Int64GetDatum(val);
+					return true;
+
+				default:
+					/* correctly rounded, as float8in() of the digits is */
+					*res = Float8GetDatum((float8) val);
+					return true;
+			}
+
+		case DATEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			if (item->type != jbvString ||
+				!DecodeISO8601DateTime(item->val.string.val,
+									   item->val.string.len,
+									   tm, &fsec, &has_time, &has_tz, &tz))
+				return false;
+
+			if (returning->typid == DATEOID)
+			{
+				if (has_time)
+					return false;
+
+				*res = DateADTGetDatum(date2j(tm->tm_year, tm->tm_mon,
+											  tm->tm_mday) -
+									   POSTGRES_EPOCH_JDATE);
+				return true;
+			}
+			else
+			{
+				Timestamp	result;
+
+				/* timestamp input ignores the zone, let it do that */
+				if (returning->typid == TIMESTAMPOID)
+				{
+					if (has_tz)
+						return false;
+					if (tm2timestamp(tm, fsec, NULL, &result) != 0)
+						return false;
+				}
+				else
+				{
+					if (!has_tz)
+						tz = DetermineTimeZoneOffset(tm, session_timezone);
+					if (tm2timestamp(tm, fsec, &tz, &result) != 0)
+						return false;
+				}
+
+				*res = TimestampGetDatum(result);
+				return true;
+			}
+
+		default:
+			return false;
+	}
+}
+
 typedef Datum (*JsonFunc)(ExprEvalStep *op, ExprContext *econtext,
 						  Datum item, bool *resnull, void *p, bool *error);
 
@@ -4815,6 +4930,8 @@ ExecEvalJsonExprSubtrans(JsonFunc func, ExprEvalStep *op,
 typedef struct
 {
 	JsonPath   *path;
+	Oid			typid;			/* type of the context item */
+	JsonbValue *item;			/* item found by the caller, if any */
 	bool	   *error;
 	bool		coercionInSubtrans;
 } ExecEvalJsonExprContext;
@@ -4834,8 +4951,11 @@ ExecEvalJsonExpr(ExprEvalStep *op, ExprContext *econtext,
 	switch (jexpr->op)
 	{
 		case IS_JSON_QUERY:
-			res = JsonPathQuery(item, path, jexpr->wrapper, &empty, error,
-								op->d.jsonexpr.args);
+			if (cxt->item)
+				res = JsonItemQuery(cxt->item, jexpr->wrapper);
+			else
+				res = JsonPathQuery(item, cxt->typid, path, jexpr->wrapper,
+									&empty, error, op->d.jsonexpr.args);
 			*resnull = !DatumGetPointer(res);
 			if (error && *error)
 				return (Datum) 0;
@@ -4844,8 +4964,10 @@ ExecEvalJsonExpr(ExprEvalStep *op, ExprContext *econtext,
 		case IS_JSON_VALUE:
 			{
 				struct JsonCoercionState *jcstate;
-				JsonbValue *jbv = JsonPathValue(item, path, &empty, error,
-												op->d.jsonexpr.args);
+				JsonbValue *jbv = cxt->item ?
+					JsonItemValue(cxt->item, error) :
+					JsonPathValue(item, cxt->typid, path, &empty, error,
+								  op->d.jsonexpr.args);
 
 				if (error && *error)
 					return (Datum) 0;
@@ -4866,6 +4988,10 @@ ExecEvalJsonExpr(ExprEvalStep *op, ExprContext *econtext,
 					break;
 				}
 
+				/* Try to convert the item without evaluating the coercion */
+				if (ExecJsonItemDirectCoercion(jbv, jexpr->returning, &res))
+					return res;
+
 				/* Use coercion from SQL/JSON item type to the output type */
 				res = ExecPrepareJsonItemCoercion(jbv,
 												  op->d.jsonexpr.jsexpr->returning,
@@ -4906,9 +5032,9 @@ ExecEvalJsonExpr(ExprEvalStep *op, ExprContext *econtext,
 
 		case IS_JSON_EXISTS:
 			{
-				bool		exists = JsonPathExists(item, path,
-													op->d.jsonexpr.args,
-													error);
+				bool		exists = cxt->item ||
+					JsonPathExists(item, cxt->typid, path,
+								   op->d.jsonexpr.args, error);
 
 				*resnull = error && *error;
 				res = BoolGetDatum(exists);
@@ -5030,6 +5156,8 @@ ExecEvalJson(ExprState *state, ExprEvalStep *op, ExprContext *econtext)
 	needSubtrans = ExecEvalJsonNeedsSubTransaction(jexpr, &op->d.jsonexpr.coercions);
 
 	cxt.path = path;
+	cxt.typid = exprType(jexpr->formatted_expr);
+	cxt.item = op->d.jsonexpr.item ? *op->d.jsonexpr.item : NULL;
 	cxt.error = throwErrors ? NULL : &error;
 	cxt.coercionInSubtrans = !needSubtrans && !throwErrors;
 	Assert(!needSubtrans || cxt.error);
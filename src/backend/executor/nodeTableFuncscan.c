@@ -19,6 +19,13 @@
  *		ExecInitTableFuncscan	creates and initializes a TableFuncscan node.
  *		ExecEndTableFuncscan		releases any storage allocated.
  *		ExecReScanTableFuncscan rescans the function
+ *
+ *		ExecTableFuncScanEstimate		estimates DSM space needed for
+ *										parallel scan
+ *		ExecTableFuncScanInitializeDSM	initialize DSM for parallel scan
+ *		ExecTableFuncScanReInitializeDSM reinitialize DSM for fresh scan
+ *		ExecTableFuncScanInitializeWorker attach to DSM info in parallel
+ *										worker
  */
 #include "postgres.h"
 
@@ -251,9 +258,10 @@ ExecReScanTableFuncScan(TableFuncScanState *node)
 	ExecScanReScan(&node->ss);
 
 	/*
-	 * Recompute when parameters are changed.
+	 * Recompute when parameters are changed.  A parallel scan must also start
+	 * over, since the rows are divided among the processes anew.
 	 */
-	if (chgparam)
+	if (chgparam || node->pstate != NULL)
 	{
 		if (node->tupstore != NULL)
 		{
@@ -526,3 +534,72 @@ tfuncLoadRows(TableFuncScanState *tstate, ExprContext *econtext)
 
 	MemoryContextSwitchTo(oldcxt);
 }
+
+/* ----------------------------------------------------------------
+ *						Parallel Scan Support
+ * ----------------------------------------------------------------
+ */
+
+/* ----------------------------------------------------------------
+ *		ExecTableFuncScanEstimate
+ *
+ *		Compute the amount of space we'll need in the parallel
+ *		query DSM, and inform pcxt->estimator about our needs.
+ * ----------------------------------------------------------------
+ */
+void
+ExecTableFuncScanEstimate(TableFuncScanState *node,
+						  ParallelContext *pcxt)
+{
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   sizeof(ParallelTableFuncScanState));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecTableFuncScanInitializeDSM
+ *
+ *		Set up the shared state of a parallel table function scan.
+ *		Every process evaluates the document itself, and the table
+ *		builder produces rows only for the row pattern items it claims
+ *		from the shared state.
+ * ----------------------------------------------------------------
+ */
+void
+ExecTableFuncScanInitializeDSM(TableFuncScanState *node,
+							   ParallelContext *pcxt)
+{
+	ParallelTableFuncScanState *pstate;
+
+	pstate = shm_toc_allocate(pcxt->toc, sizeof(ParallelTableFuncScanState));
+	pg_atomic_init_u32(&pstate->next_item, 0);
+	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pstate);
+	node->pstate = pstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecTableFuncScanReInitializeDSM
+ *
+ *		Reset shared state before beginning a fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecTableFuncScanReInitializeDSM(TableFuncScanState *node,
+								 ParallelContext *pcxt)
+{
+	pg_atomic_write_u32(&node->pstate->next_item, 0);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecTableFuncScanInitializeWorker
+ *
+ *		Copy relevant information from TOC into planstate.
+ * ----------------------------------------------------------------
+ */
+void
+ExecTableFuncScanInitializeWorker(TableFuncScanState *node,
+								  ParallelWorkerContext *pwcxt)
+{
+	node->pstate = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id,
+								  false);
+}
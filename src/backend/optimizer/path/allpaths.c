@@ -702,8 +702,15 @@ set_rel_consider_parallel(PlannerInfo *root, RelOptInfo *rel,
 			break;
 
 		case RTE_TABLEFUNC:
-			/* not parallel safe */
-			return;
+
+			/*
+			 * XMLTABLE is not parallel safe.  JSON_TABLE is, unless it has
+			 * parallel-restricted expressions.
+			 */
+			if (rte->tablefunc->functype != TFT_JSON_TABLE ||
+				!is_parallel_safe(root, (Node *) rte->tablefunc))
+				return;
+			break;
 
 		case RTE_VALUES:
 			/* Check for parallel-restricted functions. */
@@ -2486,7 +2493,27 @@ set_tablefunc_pathlist(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
 
 	/* Generate appropriate path */
 	add_path(rel, create_tablefuncscan_path(root, rel,
-											required_outer));
+											required_outer, 0));
+
+	/*
+	 * JSON_TABLE can divide the items of its row pattern among parallel
+	 * workers, each of which evaluates the document on its own, so it must
+	 * come out the same in all of them.  rel->pages reflects the size of the
+	 * document, if it's known.
+	 */
+	if (rel->consider_parallel && required_outer == NULL &&
+		rte->tablefunc->functype == TFT_JSON_TABLE &&
+		!contain_volatile_functions(rte->tablefunc->docexpr))
+	{
+		int			parallel_workers;
+
+		parallel_workers = compute_parallel_worker(rel, rel->pages, -1,
+												   max_parallel_workers_per_gather);
+
+		if (parallel_workers > 0)
+			add_partial_path(rel, create_tablefuncscan_path(root, rel, NULL,
+															parallel_workers));
+	}
 }
 
 /*
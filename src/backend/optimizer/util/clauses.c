@@ -121,6 +121,9 @@ static bool is_strict_saop(ScalarArrayOpExpr *expr, bool falseOK);
 static Node *eval_const_expressions_mutator(Node *node,
 											eval_const_expressions_context *context);
 static bool contain_non_const_walker(Node *node, void *context);
+static bool ece_json_coercion_is_immutable(JsonCoercion *coercion,
+										   JsonReturning *returning);
+static bool ece_json_expr_is_foldable(JsonExpr *jexpr);
 static bool ece_function_is_safe(Oid funcid,
 								 eval_const_expressions_context *context);
 static Node *apply_const_relabel(Node *arg, Oid rtype,
@@ -162,6 +165,7 @@ static Query *substitute_actual_srf_parameters(Query *expr,
 											   int nargs, List *args);
 static Node *substitute_actual_srf_parameters_mutator(Node *node,
 													  substitute_actual_srf_parameters_context *context);
+static bool pull_paramids_walker(Node *node, Bitmapset **context);
 
 
 /*****************************************************************************
@@ -3581,6 +3585,55 @@ eval_const_expressions_mutator(Node *node,
 					return ece_evaluate_expr((Node *) newcre);
 				return (Node *) newcre;
 			}
+		case T_JsonConstructorExpr:
+			{
+				JsonConstructorExpr *ctor;
+				Node	   *save_case_val = context->case_val;
+
+				/*
+				 * The RETURNING coercion refers to the constructor's result
+				 * through its own CaseTestExpr, which must not be replaced
+				 * by the test value of some enclosing CASE.
+				 */
+				context->case_val = NULL;
+				ctor = (JsonConstructorExpr *) ece_generic_processing(node);
+				context->case_val = save_case_val;
+
+				/*
+				 * JSON(), JSON_SCALAR(), JSON_SERIALIZE(), JSON_OBJECT() and
+				 * JSON_ARRAY() with all-constant arguments can be evaluated
+				 * once here, if the conversions of their arguments to json
+				 * and the RETURNING coercion are immutable.  Aggregate
+				 * constructors are represented by an underlying function
+				 * call and are never folded.
+				 */
+				if (!ctor->func &&
+					!contain_non_const_walker((Node *) ctor->args, NULL) &&
+					!contain_mutable_functions((Node *) ctor))
+					return ece_evaluate_expr(ctor);
+				return (Node *) ctor;
+			}
+		case T_JsonExpr:
+			{
+				JsonExpr   *jexpr;
+				Node	   *save_case_val = context->case_val;
+
+				/* Protect the placeholders of coercions, as above */
+				context->case_val = NULL;
+				jexpr = (JsonExpr *) ece_generic_processing(node);
+				context->case_val = save_case_val;
+
+				/*
+				 * JSON_VALUE(), JSON_QUERY() and JSON_EXISTS() over a
+				 * constant context item, path and PASSING arguments are
+				 * evaluated at plan time, so that the path is executed only
+				 * once rather than for every row.  Errors are handled
+				 * according to the ON ERROR clause just as at run time.
+				 */
+				if (ece_json_expr_is_foldable(jexpr))
+					return ece_evaluate_expr(jexpr);
+				return (Node *) jexpr;
+			}
 		case T_JsonValueExpr:
 			{
 				JsonValueExpr *jve = (JsonValueExpr *) node;
@@ -3640,6 +3693,93 @@ contain_non_const_walker(Node *node, void *context)
 	return true;
 }
 
+/*
+ * Subroutine for eval_const_expressions: check whether a coercion of SQL/JSON
+ * function result to the RETURNING type can be performed at plan time.
+ */
+static bool
+ece_json_coercion_is_immutable(JsonCoercion *coercion, JsonReturning *returning)
+{
+	if (!coercion)
+		return true;
+
+	/* json_populate_type() is not immutable, it works with arbitrary types */
+	if (coercion->via_populate)
+		return false;
+
+	if (coercion->via_io)
+	{
+		Oid			typinput;
+		Oid			typioparam;
+
+		getTypeInputInfo(returning->typid, &typinput, &typioparam);
+
+		return func_volatile(typinput) == PROVOLATILE_IMMUTABLE;
+	}
+
+	return !contain_mutable_functions(coercion->expr);
+}
+
+/*
+ * Subroutine for eval_const_expressions: check whether an already
+ * const-simplified JsonExpr can be reduced to a constant.
+ */
+static bool
+ece_json_expr_is_foldable(JsonExpr *jexpr)
+{
+	JsonItemCoercions *coercions = jexpr->coercions;
+
+	/* JSON_TABLE executor needs the context item expression itself */
+	if (jexpr->op == IS_JSON_TABLE)
+		return false;
+
+	if (!IsA(jexpr->formatted_expr, Const) ||
+		!IsA(jexpr->path_spec, Const) ||
+		contain_non_const_walker((Node *) jexpr->passing_values, NULL))
+		return false;
+
+	/* DEFAULT expressions of ON EMPTY and ON ERROR also need to be constant */
+	if (jexpr->on_empty && jexpr->on_empty->default_expr &&
+		!IsA(jexpr->on_empty->default_expr, Const))
+		return false;
+
+	if (jexpr->on_error->default_expr &&
+		!IsA(jexpr->on_error->default_expr, Const))
+		return false;
+
+	/* Check jsonpath itself, see contain_mutable_functions_walker() */
+	if (contain_mutable_functions((Node *) jexpr))
+		return false;
+
+	/* OMIT QUOTES is implemented using the input function of RETURNING type */
+	if (jexpr->omit_quotes)
+	{
+		Oid			typinput;
+		Oid			typioparam;
+
+		getTypeInputInfo(jexpr->returning->typid, &typinput, &typioparam);
+
+		if (func_volatile(typinput) != PROVOLATILE_IMMUTABLE)
+			return false;
+	}
+
+	if (!ece_json_coercion_is_immutable(jexpr->result_coercion,
+										jexpr->returning))
+		return false;
+
+	return !coercions ||
+		(ece_json_coercion_is_immutable(coercions->null, jexpr->returning) &&
+		 ece_json_coercion_is_immutable(coercions->string, jexpr->returning) &&
+		 ece_json_coercion_is_immutable(coercions->numeric, jexpr->returning) &&
+		 ece_json_coercion_is_immutable(coercions->boolean, jexpr->returning) &&
+		 ece_json_coercion_is_immutable(coercions->date, jexpr->returning) &&
+		 ece_json_coercion_is_immutable(coercions->time, jexpr->returning) &&
+		 ece_json_coercion_is_immutable(coercions->timetz, jexpr->returning) &&
+		 ece_json_coercion_is_immutable(coercions->timestamp, jexpr->returning) &&
+		 ece_json_coercion_is_immutable(coercions->timestamptz, jexpr->returning) &&
+		 ece_json_coercion_is_immutable(coercions->composite, jexpr->returning));
+}
+
 /*
  * Subroutine for eval_const_expressions: check if a function is OK to evaluate
  */
@@ -5255,3 +5395,33 @@ substitute_actual_srf_parameters_mutator(Node *node,
 								   substitute_actual_srf_parameters_mutator,
 								   (void *) context);
 }
+
+/*
+ * pull_paramids
+ *		Returns a Bitmapset containing the paramids of all Params in 'expr'.
+ */
+Bitmapset *
+pull_paramids(Expr *expr)
+{
+	Bitmapset  *result = NULL;
+
+	(void) pull_paramids_walker((Node *) expr, &result);
+
+	return result;
+}
+
+static bool
+pull_paramids_walker(Node *node, Bitmapset **context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Param))
+	{
+		Param	   *param = (Param *) node;
+
+		*context = bms_add_member(*context, param->paramid);
+		return false;
+	}
+	return expression_tree_walker(node, pull_paramids_walker,
+								  (void *) context);
+}
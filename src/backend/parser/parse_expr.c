@@ -4676,8 +4676,6 @@ static void
 transformJsonFuncExprOutput(ParseState *pstate,	JsonFuncExpr *func,
 							JsonExpr *jsexpr)
 {
-	Node	   *expr = jsexpr->formatted_expr;
-
 	jsexpr->returning = transformJsonOutput(pstate, func->output, false);
 
 	/* JSON_VALUE returns text by default */
@@ -4689,8 +4687,6 @@ transformJsonFuncExprOutput(ParseState *pstate,	JsonFuncExpr *func,
 
 	if (OidIsValid(jsexpr->returning->typid))
 	{
-		JsonReturning ret;
-
 		if (func->op == IS_JSON_VALUE &&
 			jsexpr->returning->typid != JSONOID &&
 			jsexpr->returning->typid != JSONBOID)
@@ -4701,24 +4697,27 @@ transformJsonFuncExprOutput(ParseState *pstate,	JsonFuncExpr *func,
 			jsexpr->result_coercion->via_io = true;
 			return;
 		}
-
-		assignDefaultJsonReturningType(jsexpr->formatted_expr, jsexpr->format, &ret);
-
-		if (ret.typid != jsexpr->returning->typid ||
-			ret.typmod != jsexpr->returning->typmod)
-		{
-			Node	   *placeholder = makeCaseTestExpr(expr);
-
-			Assert(((CaseTestExpr *) placeholder)->typeId == ret.typid);
-			Assert(((CaseTestExpr *) placeholder)->typeMod == ret.typmod);
-
-			jsexpr->result_coercion = coerceJsonExpr(pstate, placeholder,
-													 jsexpr->returning);
-		}
 	}
 	else
 		assignDefaultJsonReturningType(jsexpr->formatted_expr, jsexpr->format,
 									   jsexpr->returning);
+
+	/*
+	 * SQL/JSON items are always produced in jsonb form, even for json context
+	 * items, so coerce them from jsonb if the output type differs.
+	 */
+	if (jsexpr->returning->typid != JSONBOID ||
+		jsexpr->returning->typmod != -1)
+	{
+		CaseTestExpr *placeholder = makeNode(CaseTestExpr);
+
+		placeholder->typeId = JSONBOID;
+		placeholder->typeMod = -1;
+		placeholder->collation = InvalidOid;
+
+		jsexpr->result_coercion = coerceJsonExpr(pstate, (Node *) placeholder,
+												 jsexpr->returning);
+	}
 }
 
 /*
@@ -4822,14 +4821,11 @@ static Node *
 transformJsonFuncExpr(ParseState *pstate, JsonFuncExpr *func)
 {
 	JsonExpr   *jsexpr = transformJsonExprCommon(pstate, func);
-	const char *func_name = NULL;
 	Node	   *contextItemExpr = jsexpr->formatted_expr;
 
 	switch (func->op)
 	{
 		case IS_JSON_VALUE:
-			func_name = "JSON_VALUE";
-
 			transformJsonFuncExprOutput(pstate, func, jsexpr);
 
 			jsexpr->returning->format->format = JS_FORMAT_DEFAULT;
@@ -4843,15 +4839,14 @@ transformJsonFuncExpr(ParseState *pstate, JsonFuncExpr *func)
 				coerceDefaultJsonExpr(pstate, jsexpr,
 									  jsexpr->on_error->default_expr);
 
+			/* non-scalar items are jsonb for any type of context item */
 			jsexpr->coercions = makeNode(JsonItemCoercions);
 			initJsonItemCoercions(pstate, jsexpr->coercions, jsexpr->returning,
-								  exprType(contextItemExpr));
+								  JSONBOID);
 
 			break;
 
 		case IS_JSON_QUERY:
-			func_name = "JSON_QUERY";
-
 			transformJsonFuncExprOutput(pstate, func, jsexpr);
 
 			jsexpr->on_empty->default_expr =
@@ -4868,8 +4863,6 @@ transformJsonFuncExpr(ParseState *pstate, JsonFuncExpr *func)
 			break;
 
 		case IS_JSON_EXISTS:
-			func_name = "JSON_EXISTS";
-
 			jsexpr->returning = transformJsonOutput(pstate, func->output, false);
 
 			jsexpr->returning->format->format = JS_FORMAT_DEFAULT;
@@ -4926,12 +4919,6 @@ transformJsonFuncExpr(ParseState *pstate, JsonFuncExpr *func)
 			break;
 	}
 
-	if (exprType(contextItemExpr) != JSONBOID)
-		ereport(ERROR,
-				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-				 errmsg("%s() is not yet implemented for json type", func_name),
-				 parser_errposition(pstate, func->location)));
-
 	return (Node *) jsexpr;
 }
 
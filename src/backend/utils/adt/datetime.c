@@ -2922,6 +2922,152 @@ DecodeTimezone(char *str, int *tzp)
 }
 
 
+/*
+ * Read exactly ndigits decimal digits at *str, advancing it.
+ */
+static bool
+ParseFixedDigits(const char **str, const char *end, int ndigits, int *val)
+{
+	const char *cp = *str;
+
+	if (end - cp < ndigits)
+		return false;
+
+	*val = 0;
+	for (; ndigits > 0; ndigits--, cp++)
+	{
+		if (!isdigit((unsigned char) *cp))
+			return false;
+		*val = *val * 10 + (*cp - '0');
+	}
+
+	*str = cp;
+	return true;
+}
+
+/* DecodeISO8601DateTime()
+ * Fast path for decoding a date or timestamp in the strict ISO 8601 format
+ * "YYYY-MM-DD[( |T)HH:MM[:SS[.ffffff]][Z|(+|-)HH[:MM]]]", as produced by the
+ * json output of date/time values.
+ *
+ * Returns false if the string is not exactly in that form or the fields are
+ * out of range; the caller should then fall back to the general input
+ * routines, which handle everything else and report errors.  Otherwise, the
+ * fields are returned in *tm and *fsec, *has_time tells whether the time was
+ * specified, and *has_tz whether a zone offset was, which is then returned
+ * in *tzp in seconds west of UTC as DecodeTimezone() does.
+ */
+bool
+DecodeISO8601DateTime(const char *str, int len, struct pg_tm *tm,
+					  fsec_t *fsec, bool *has_time, bool *has_tz, int *tzp)
+{
+	const char *end = str + len;
+	int			hr,
+				min;
+
+	*fsec = 0;
+	*has_time = false;
+	*has_tz = false;
+	tm->tm_hour = 0;
+	tm->tm_min = 0;
+	tm->tm_sec = 0;
+
+	if (!ParseFixedDigits(&str, end, 4, &tm->tm_year) ||
+		str >= end || *str++ != '-' ||
+		!ParseFixedDigits(&str, end, 2, &tm->tm_mon) ||
+		str >= end || *str++ != '-' ||
+		!ParseFixedDigits(&str, end, 2, &tm->tm_mday))
+		return false;
+
+	if (tm->tm_year < 1 ||
+		tm->tm_mon < 1 || tm->tm_mon > MONTHS_PER_YEAR ||
+		tm->tm_mday < 1 ||
+		tm->tm_mday > day_tab[isleap(tm->tm_year)][tm->tm_mon - 1])
+		return false;
+
+	if (str == end)
+		return true;
+
+	if (*str != ' ' && *str != 'T')
+		return false;
+	str++;
+
+	if (!ParseFixedDigits(&str, end, 2, &tm->tm_hour) ||
+		str >= end || *str++ != ':' ||
+		!ParseFixedDigits(&str, end, 2, &tm->tm_min))
+		return false;
+
+	if (str < end && *str == ':')
+	{
+		str++;
+		if (!ParseFixedDigits(&str, end, 2, &tm->tm_sec))
+			return false;
+
+		if (str < end && *str == '.')
+		{
+			int			scale = USECS_PER_SEC;
+
+			/* more than 6 fractional digits would need rounding */
+			for (str++; str < end && isdigit((unsigned char) *str); str++)
+			{
+				if (scale == 1)
+					return false;
+				scale /= 10;
+				*fsec += (*str - '0') * scale;
+			}
+
+			if (scale == USECS_PER_SEC)
+				return false;
+		}
+	}
+
+	if (tm->tm_hour >= HOURS_PER_DAY ||
+		tm->tm_min >= MINS_PER_HOUR ||
+		tm->tm_sec >= SECS_PER_MINUTE)
+		return false;
+
+	*has_time = true;
+
+	if (str == end)
+		return true;
+
+	if (*str == 'Z')
+	{
+		*tzp = 0;
+		str++;
+	}
+	else if (*str == '+' || *str == '-')
+	{
+		bool		neg = *str++ == '-';
+
+		if (!ParseFixedDigits(&str, end, 2, &hr))
+			return false;
+
+		min = 0;
+		if (str < end && *str == ':')
+		{
+			str++;
+			if (!ParseFixedDigits(&str, end, 2, &min))
+				return false;
+		}
+
+		/* Range-check the values; see notes in datatype/timestamp.h */
+		if (hr > MAX_TZDISP_HOUR || min >= MINS_PER_HOUR)
+			return false;
+
+		*tzp = (hr * MINS_PER_HOUR + min) * SECS_PER_MINUTE;
+		if (!neg)
+			*tzp = -*tzp;
+	}
+	else
+		return false;
+
+	*has_tz = true;
+
+	return str == end;
+}
+
+
 /* DecodeTimezoneAbbrev()
  * Interpret string as a timezone abbreviation, if possible.
  *
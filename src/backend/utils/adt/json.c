@@ -30,17 +30,53 @@
 #include "utils/lsyscache.h"
 #include "utils/typcache.h"
 
-/* Common context for key uniqueness check */
-typedef struct HTAB *JsonUniqueCheckState;	/* hash table for key names */
+/*
+ * Reference to an object key for key uniqueness check.  Keys are not copied
+ * into the hash table, they are referenced by their offset in the buffer
+ * they were written to, which may be reallocated while the check is running.
+ */
+typedef struct JsonUniqueKey
+{
+	StringInfo	buf;			/* buffer containing key */
+	int			offset;			/* offset of key in buf->data */
+	int			len;			/* length of key */
+} JsonUniqueKey;
 
 /* Hash entry for JsonUniqueCheckState */
 typedef struct JsonUniqueHashEntry
 {
-	const char *key;
-	int			key_len;
-	int			object_id;
+	JsonUniqueKey key;
+	uint32		hash;
+	char		status;
 } JsonUniqueHashEntry;
 
+#define JSON_UNIQUE_KEY_DATA(k) ((k).buf->data + (k).offset)
+
+#define SH_PREFIX		json_unique
+#define SH_ELEMENT_TYPE	JsonUniqueHashEntry
+#define SH_KEY_TYPE		JsonUniqueKey
+#define SH_KEY			key
+#define SH_HASH_KEY(tb, key) \
+	hash_bytes((const unsigned char *) JSON_UNIQUE_KEY_DATA(key), (key).len)
+#define SH_EQUAL(tb, a, b) \
+	((a).len == (b).len && \
+	 memcmp(JSON_UNIQUE_KEY_DATA(a), JSON_UNIQUE_KEY_DATA(b), (a).len) == 0)
+#define SH_STORE_HASH
+#define SH_GET_HASH(tb, a) a->hash
+#define SH_SCOPE		static inline
+#define SH_DECLARE
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
+/* Common context for key uniqueness check: keys of a single object */
+typedef json_unique_hash *JsonUniqueCheckState;
+
+/*
+ * Tables grown larger than this are not reused for subsequent objects,
+ * because resetting them would cost more than creating a new one.
+ */
+#define JSON_UNIQUE_MAX_REUSED_SIZE	1024
+
 /* Context for key uniqueness check in builder functions */
 typedef struct JsonUniqueBuilderState
 {
@@ -53,16 +89,17 @@ typedef struct JsonUniqueBuilderState
 typedef struct JsonUniqueStackEntry
 {
 	struct JsonUniqueStackEntry *parent;
-	int			object_id;
+	JsonUniqueCheckState check;	/* keys of this object */
+	int			keys_start;		/* start of object's keys in key arena */
 } JsonUniqueStackEntry;
 
 /* State for key uniqueness check during json parsing */
 typedef struct JsonUniqueParsingState
 {
 	JsonLexContext *lex;
-	JsonUniqueCheckState check;
+	StringInfoData keys;		/* arena for keys of the enclosing objects */
 	JsonUniqueStackEntry *stack;
-	int			id_counter;
+	JsonUniqueStackEntry *free_entries;	/* stack entries for reuse */
 	bool		unique;
 } JsonUniqueParsingState;
 
@@ -74,10 +111,18 @@ typedef struct JsonAggState
 	JsonTypeCategory val_category;
 	Oid			val_output_func;
 	JsonUniqueBuilderState unique_check;
+	/* offsets of json_agg elements in str, for the inverse transition */
+	int		   *elem_offsets;
+	int			first_elem;
+	int			nelems;
+	int			elems_size;
 } JsonAggState;
 
 static void composite_to_json(Datum composite, StringInfo result,
 							  bool use_line_feeds);
+static void json_categorize_attribute(Oid typoid, int *tcategory,
+									  Oid *outfuncoid);
+static void json_agg_add_elem_offset(JsonAggState *state);
 static void array_dim_to_json(StringInfo result, int dim, int ndims, int *dims,
 							  Datum *vals, bool *nulls, int *valcount,
 							  JsonTypeCategory tcategory, Oid outfuncoid,
@@ -87,6 +132,9 @@ static void array_to_json_internal(Datum array, StringInfo result,
 static void datum_to_json(Datum val, bool is_null, StringInfo result,
 						  JsonTypeCategory tcategory, Oid outfuncoid,
 						  bool key_scalar);
+static void datum_to_json_internal(Datum val, bool is_null, StringInfo result,
+								   JsonTypeCategory tcategory, Oid outfuncoid,
+								   FmgrInfo *outfunc, bool key_scalar);
 static void add_json(Datum val, bool is_null, StringInfo result,
 					 Oid val_type, bool key_scalar);
 static text *catenate_stringinfo_string(StringInfo buffer, const char *addon);
@@ -268,6 +316,19 @@ static void
 datum_to_json(Datum val, bool is_null, StringInfo result,
 			  JsonTypeCategory tcategory, Oid outfuncoid,
 			  bool key_scalar)
+{
+	datum_to_json_internal(val, is_null, result, tcategory, outfuncoid, NULL,
+						   key_scalar);
+}
+
+/*
+ * Workhorse for datum_to_json.  If "outfunc" is not NULL, it is the lookup
+ * info of outfuncoid, which saves looking it up for each value.
+ */
+static void
+datum_to_json_internal(Datum val, bool is_null, StringInfo result,
+					   JsonTypeCategory tcategory, Oid outfuncoid,
+					   FmgrInfo *outfunc, bool key_scalar)
 {
 	char	   *outputstr;
 	text	   *jsontext;
@@ -308,7 +369,8 @@ datum_to_json(Datum val, bool is_null, StringInfo result,
 				appendStringInfoString(result, outputstr);
 			break;
 		case JSONTYPE_NUMERIC:
-			outputstr = OidOutputFunctionCall(outfuncoid, val);
+			outputstr = outfunc ? OutputFunctionCall(outfunc, val) :
+				OidOutputFunctionCall(outfuncoid, val);
 
 			/*
 			 * Don't call escape_json for a non-key if it's a valid JSON
@@ -346,20 +408,23 @@ datum_to_json(Datum val, bool is_null, StringInfo result,
 			break;
 		case JSONTYPE_JSON:
 			/* JSON and JSONB output will already be escaped */
-			outputstr = OidOutputFunctionCall(outfuncoid, val);
+			outputstr = outfunc ? OutputFunctionCall(outfunc, val) :
+				OidOutputFunctionCall(outfuncoid, val);
 			appendStringInfoString(result, outputstr);
 			pfree(outputstr);
 			break;
 		case JSONTYPE_CAST:
 			/* outfuncoid refers to a cast function, not an output function */
-			jsontext = DatumGetTextPP(OidFunctionCall1(outfuncoid, val));
+			jsontext = DatumGetTextPP(outfunc ? FunctionCall1(outfunc, val) :
+									   OidFunctionCall1(outfuncoid, val));
 			outputstr = text_to_cstring(jsontext);
 			appendStringInfoString(result, outputstr);
 			pfree(outputstr);
 			pfree(jsontext);
 			break;
 		default:
-			outputstr = OidOutputFunctionCall(outfuncoid, val);
+			outputstr = outfunc ? OutputFunctionCall(outfunc, val) :
+				OidOutputFunctionCall(outfuncoid, val);
 			escape_json(result, outputstr);
 			pfree(outputstr);
 			break;
@@ -588,10 +653,10 @@ composite_to_json(Datum composite, StringInfo result, bool use_line_feeds)
 	Oid			tupType;
 	int32		tupTypmod;
 	TupleDesc	tupdesc;
+	JsonCompositePlan *plan;
 	HeapTupleData tmptup,
 			   *tuple;
 	int			i;
-	bool		needsep = false;
 	const char *sep;
 
 	sep = use_line_feeds ? ",\n " : ",";
@@ -602,51 +667,67 @@ composite_to_json(Datum composite, StringInfo result, bool use_line_feeds)
 	tupType = HeapTupleHeaderGetTypeId(td);
 	tupTypmod = HeapTupleHeaderGetTypMod(td);
 	tupdesc = lookup_rowtype_tupdesc(tupType, tupTypmod);
+	plan = json_composite_plan_acquire(tupdesc, false,
+									   json_categorize_attribute);
 
 	/* Build a temporary HeapTuple control structure */
 	tmptup.t_len = HeapTupleHeaderGetDatumLength(td);
 	tmptup.t_data = td;
 	tuple = &tmptup;
 
-	appendStringInfoChar(result, '{');
-
-	for (i = 0; i < tupdesc->natts; i++)
+	/* the plan must be released on error too, or it can never be freed */
+	PG_TRY();
 	{
-		Datum		val;
-		bool		isnull;
-		char	   *attname;
-		JsonTypeCategory tcategory;
-		Oid			outfuncoid;
-		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
-
-		if (att->attisdropped)
-			continue;
+		appendStringInfoChar(result, '{');
 
-		if (needsep)
-			appendStringInfoString(result, sep);
-		needsep = true;
+		for (i = 0; i < plan->ncolumns; i++)
+		{
+			JsonCompositeColumn *col = &plan->columns[i];
+			Datum		val;
+			bool		isnull;
 
-		attname = NameStr(att->attname);
-		escape_json(result, attname);
-		appendStringInfoChar(result, ':');
+			if (i > 0)
+				appendStringInfoString(result, sep);
 
-		val = heap_getattr(tuple, i + 1, tupdesc, &isnull);
+			appendBinaryStringInfo(result, col->key, col->keylen);
 
-		if (isnull)
-		{
-			tcategory = JSONTYPE_NULL;
-			outfuncoid = InvalidOid;
+			val = heap_getattr(tuple, col->attnum, tupdesc, &isnull);
+
+			if (isnull)
+				datum_to_json_internal(val, true, result, JSONTYPE_NULL,
+									   InvalidOid, NULL, false);
+			else
+				datum_to_json_internal(val, false, result,
+									   (JsonTypeCategory) col->tcategory,
+									   col->outfuncoid,
+									   OidIsValid(col->outfuncoid) ?
+									   &col->outfunc : NULL,
+									   false);
 		}
-		else
-			json_categorize_type(att->atttypid, &tcategory, &outfuncoid);
 
-		datum_to_json(val, isnull, result, tcategory, outfuncoid, false);
+		appendStringInfoChar(result, '}');
 	}
+	PG_FINALLY();
+	{
+		json_composite_plan_release(plan);
+	}
+	PG_END_TRY();
 
-	appendStringInfoChar(result, '}');
 	ReleaseTupleDesc(tupdesc);
 }
 
+/*
+ * json_categorize_type() as a JsonCategorizeTypeFunc
+ */
+static void
+json_categorize_attribute(Oid typoid, int *tcategory, Oid *outfuncoid)
+{
+	JsonTypeCategory category;
+
+	json_categorize_type(typoid, &category, outfuncoid);
+	*tcategory = (int) category;
+}
+
 /*
  * Append JSON text for "val" to "result".
  *
@@ -808,6 +889,22 @@ to_json(PG_FUNCTION_ARGS)
 	PG_RETURN_DATUM(to_json_worker(val, tcategory, outfuncoid));
 }
 
+/*
+ * Remember where the json_agg element about to be appended starts.
+ */
+static void
+json_agg_add_elem_offset(JsonAggState *state)
+{
+	if (state->nelems >= state->elems_size)
+	{
+		state->elems_size *= 2;
+		state->elem_offsets = repalloc(state->elem_offsets,
+									   sizeof(int) * state->elems_size);
+	}
+
+	state->elem_offsets[state->nelems++] = state->str->len;
+}
+
 /*
  * json_agg transition function
  *
@@ -845,8 +942,13 @@ json_agg_transfn_worker(FunctionCallInfo fcinfo, bool absent_on_null)
 		oldcontext = MemoryContextSwitchTo(aggcontext);
 		state = (JsonAggState *) palloc(sizeof(JsonAggState));
 		state->str = makeStringInfo();
+		state->elems_size = 16;
+		state->elem_offsets = palloc(sizeof(int) * state->elems_size);
 		MemoryContextSwitchTo(oldcontext);
 
+		state->first_elem = 0;
+		state->nelems = 0;
+
 		appendStringInfoChar(state->str, '[');
 		json_categorize_type(arg_type, &state->val_category,
 							 &state->val_output_func);
@@ -865,6 +967,7 @@ json_agg_transfn_worker(FunctionCallInfo fcinfo, bool absent_on_null)
 	/* fast path for NULLs */
 	if (PG_ARGISNULL(1))
 	{
+		json_agg_add_elem_offset(state);
 		datum_to_json((Datum) 0, true, state->str, JSONTYPE_NULL,
 					  InvalidOid, false);
 		PG_RETURN_POINTER(state);
@@ -880,6 +983,7 @@ json_agg_transfn_worker(FunctionCallInfo fcinfo, bool absent_on_null)
 		appendStringInfoString(state->str, "\n ");
 	}
 
+	json_agg_add_elem_offset(state);
 	datum_to_json(val, false, state->str, state->val_category,
 				  state->val_output_func, false);
 
@@ -910,6 +1014,81 @@ json_agg_strict_transfn(PG_FUNCTION_ARGS)
 	return json_agg_transfn_worker(fcinfo, true);
 }
 
+/*
+ * json_agg inverse transition function
+ *
+ * remove the first aggregated element, for moving-aggregate mode.
+ */
+static Datum
+json_agg_invtransfn_worker(FunctionCallInfo fcinfo, bool absent_on_null)
+{
+	JsonAggState *state;
+	StringInfo	str;
+	int			shift;
+	int			i;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+	{
+		/* cannot be called directly because of internal-type argument */
+		elog(ERROR, "json_agg_invtransfn called in non-aggregate context");
+	}
+
+	/* the state is never NULL in moving-aggregate mode */
+	Assert(!PG_ARGISNULL(0));
+
+	state = (JsonAggState *) PG_GETARG_POINTER(0);
+
+	/* nulls were not added by json_agg_strict */
+	if (absent_on_null && PG_ARGISNULL(1))
+		PG_RETURN_POINTER(state);
+
+	/*
+	 * Rows are removed in the order they were added, so just skip the first
+	 * remaining element.  Once the skipped elements outnumber the remaining
+	 * ones, move the remaining text right after the opening bracket, so that
+	 * the state looks as if only the remaining elements were aggregated.
+	 */
+	Assert(state->first_elem < state->nelems);
+
+	state->first_elem++;
+
+	if (state->first_elem < state->nelems - state->first_elem)
+		PG_RETURN_POINTER(state);
+
+	str = state->str;
+	shift = (state->first_elem < state->nelems ?
+			 state->elem_offsets[state->first_elem] : str->len) - 1;
+
+	str->len -= shift;
+	memmove(str->data + 1, str->data + 1 + shift, str->len);
+
+	state->nelems -= state->first_elem;
+	for (i = 0; i < state->nelems; i++)
+		state->elem_offsets[i] =
+			state->elem_offsets[state->first_elem + i] - shift;
+	state->first_elem = 0;
+
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * json_agg inverse transition function
+ */
+Datum
+json_agg_invtransfn(PG_FUNCTION_ARGS)
+{
+	return json_agg_invtransfn_worker(fcinfo, false);
+}
+
+/*
+ * json_agg_strict inverse transition function
+ */
+Datum
+json_agg_strict_invtransfn(PG_FUNCTION_ARGS)
+{
+	return json_agg_invtransfn_worker(fcinfo, true);
+}
+
 /*
  * json_agg final function
  */
@@ -917,6 +1096,8 @@ Datum
 json_agg_finalfn(PG_FUNCTION_ARGS)
 {
 	JsonAggState *state;
+	StringInfoData buf;
+	int			start;
 
 	/* cannot be called directly because of internal-type argument */
 	Assert(AggCheckCallContext(fcinfo, NULL));
@@ -930,72 +1111,50 @@ json_agg_finalfn(PG_FUNCTION_ARGS)
 		PG_RETURN_NULL();
 
 	/* Else return state with appropriate array terminator added */
-	PG_RETURN_TEXT_P(catenate_stringinfo_string(state->str, "]"));
-}
-
-/* Functions implementing hash table for key uniqueness check */
-static uint32
-json_unique_hash(const void *key, Size keysize)
-{
-	const JsonUniqueHashEntry *entry = (JsonUniqueHashEntry *) key;
-	uint32		hash =  hash_bytes_uint32(entry->object_id);
+	if (state->first_elem == 0)
+		PG_RETURN_TEXT_P(catenate_stringinfo_string(state->str, "]"));
 
-	hash ^= hash_bytes((const unsigned char *) entry->key, entry->key_len);
+	/* Skip the elements removed by the inverse transition function */
+	start = state->first_elem < state->nelems ?
+		state->elem_offsets[state->first_elem] : state->str->len;
 
-	return DatumGetUInt32(hash);
-}
-
-static int
-json_unique_hash_match(const void *key1, const void *key2, Size keysize)
-{
-	const JsonUniqueHashEntry *entry1 = (const JsonUniqueHashEntry *) key1;
-	const JsonUniqueHashEntry *entry2 = (const JsonUniqueHashEntry *) key2;
-
-	if (entry1->object_id != entry2->object_id)
-		return entry1->object_id > entry2->object_id ? 1 : -1;
+	initStringInfo(&buf);
+	appendStringInfoChar(&buf, '[');
+	appendBinaryStringInfo(&buf, state->str->data + start,
+						   state->str->len - start);
+	appendStringInfoChar(&buf, ']');
 
-	if (entry1->key_len != entry2->key_len)
-		return entry1->key_len > entry2->key_len ? 1 : -1;
-
-	return strncmp(entry1->key, entry2->key, entry1->key_len);
+	PG_RETURN_TEXT_P(cstring_to_text_with_len(buf.data, buf.len));
 }
 
 /* Functions implementing object key uniqueness check */
 static void
 json_unique_check_init(JsonUniqueCheckState *cxt)
 {
-	HASHCTL		ctl;
-
-	memset(&ctl, 0, sizeof(ctl));
-	ctl.keysize = sizeof(JsonUniqueHashEntry);
-	ctl.entrysize = sizeof(JsonUniqueHashEntry);
-	ctl.hcxt = CurrentMemoryContext;
-	ctl.hash = json_unique_hash;
-	ctl.match = json_unique_hash_match;
-
-	*cxt = hash_create("json object hashtable",
-					   32,
-					   &ctl,
-					   HASH_ELEM | HASH_CONTEXT | HASH_FUNCTION | HASH_COMPARE);
+	*cxt = json_unique_create(CurrentMemoryContext, 8, NULL);
 }
 
 static void
 json_unique_check_free(JsonUniqueCheckState *cxt)
 {
-	hash_destroy(*cxt);
+	json_unique_destroy(*cxt);
 }
 
+/*
+ * Check that the key, which is the tail of buffer 'buf' starting at
+ * 'offset', has not been seen in the object yet, and remember it.
+ */
 static bool
-json_unique_check_key(JsonUniqueCheckState *cxt, const char *key, int object_id)
+json_unique_check_key(JsonUniqueCheckState *cxt, StringInfo buf, int offset)
 {
-	JsonUniqueHashEntry entry;
+	JsonUniqueKey key;
 	bool		found;
 
-	entry.key = key;
-	entry.key_len = strlen(key);
-	entry.object_id = object_id;
+	key.buf = buf;
+	key.offset = offset;
+	key.len = buf->len - offset;
 
-	(void) hash_search(*cxt, &entry, HASH_ENTER, &found);
+	(void) json_unique_insert(*cxt, key, &found);
 
 	return !found;
 }
@@ -1145,7 +1304,7 @@ json_object_agg_transfn_worker(FunctionCallInfo fcinfo,
 	{
 		const char *key = &out->data[key_offset];
 
-		if (!json_unique_check_key(&state->unique_check.check, key, 0))
+		if (!json_unique_check_key(&state->unique_check.check, out, key_offset))
 			ereport(ERROR,
 					(errcode(ERRCODE_DUPLICATE_JSON_OBJECT_KEY_VALUE),
 					 errmsg("duplicate JSON key %s", key)));
@@ -1220,8 +1379,6 @@ json_object_agg_finalfn(PG_FUNCTION_ARGS)
 	if (state == NULL)
 		PG_RETURN_NULL();
 
-	json_unique_builder_free(&state->unique_check);
-
 	/* Else return state with appropriate object terminator added */
 	PG_RETURN_TEXT_P(catenate_stringinfo_string(state->str, " }"));
 }
@@ -1311,7 +1468,7 @@ json_build_object_worker(int nargs, Datum *args, bool *nulls, Oid *types,
 			/* check key uniqueness after key appending */
 			const char *key = &out->data[key_offset];
 
-			if (!json_unique_check_key(&unique_check.check, key, 0))
+			if (!json_unique_check_key(&unique_check.check, out, key_offset))
 				ereport(ERROR,
 						(errcode(ERRCODE_DUPLICATE_JSON_OBJECT_KEY_VALUE),
 						 errmsg("duplicate JSON key %s", key)));
@@ -1649,9 +1806,19 @@ json_unique_object_start(void *_state)
 	if (!state->unique)
 		return;
 
-	/* push object entry to stack */
-	entry = palloc(sizeof(*entry));
-	entry->object_id = state->id_counter++;
+	/* push object entry to stack, reusing the table of a finished object */
+	if ((entry = state->free_entries))
+	{
+		state->free_entries = entry->parent;
+		json_unique_reset(entry->check);
+	}
+	else
+	{
+		entry = palloc(sizeof(*entry));
+		json_unique_check_init(&entry->check);
+	}
+
+	entry->keys_start = state->keys.len;
 	entry->parent = state->stack;
 	state->stack = entry;
 }
@@ -1667,30 +1834,43 @@ json_unique_object_end(void *_state)
 
 	entry = state->stack;
 	state->stack = entry->parent;	/* pop object from stack */
-	pfree(entry);
+
+	/* the object's keys are no longer needed */
+	state->keys.len = entry->keys_start;
+
+	if (entry->check->size > JSON_UNIQUE_MAX_REUSED_SIZE)
+	{
+		json_unique_check_free(&entry->check);
+		pfree(entry);
+	}
+	else
+	{
+		entry->parent = state->free_entries;
+		state->free_entries = entry;
+	}
 }
 
 static void
 json_unique_object_field_start(void *_state, char *field, bool isnull)
 {
 	JsonUniqueParsingState *state = _state;
-	JsonUniqueStackEntry *entry;
+	int			offset;
 
 	if (!state->unique)
 		return;
 
+	/* copy the key to the arena */
+	offset = state->keys.len;
+	appendStringInfoString(&state->keys, field);
+
+	/* there is no object_field_end action, nobody needs the field anymore */
+	pfree(field);
+
 	/* find key collision in the current object */
-	if (json_unique_check_key(&state->check, field, state->stack->object_id))
+	if (json_unique_check_key(&state->stack->check, &state->keys, offset))
 		return;
 
 	state->unique = false;
-
-	/* pop all objects entries */
-	while ((entry = state->stack))
-	{
-		state->stack = entry->parent;
-		pfree(entry);
-	}
 }
 
 /* Validate JSON text and additionally check key uniqueness */
@@ -1706,9 +1886,9 @@ json_validate(text *json, bool check_unique_keys, bool throw_error)
 	{
 		state.lex = lex;
 		state.stack = NULL;
-		state.id_counter = 0;
+		state.free_entries = NULL;
 		state.unique = true;
-		json_unique_check_init(&state.check);
+		initStringInfo(&state.keys);
 
 		uniqueSemAction.semstate = &state;
 		uniqueSemAction.object_start = json_unique_object_start;
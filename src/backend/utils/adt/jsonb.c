@@ -40,6 +40,7 @@ typedef struct JsonbInState
 typedef struct JsonbAggState
 {
 	JsonbInState *res;
+	JsonbEncodeState *encoder;	/* accumulated array, for jsonb_agg */
 	JsonbTypeCategory key_category;
 	Oid			key_output_func;
 	JsonbTypeCategory val_category;
@@ -55,7 +56,18 @@ static void jsonb_in_array_end(void *pstate);
 static void jsonb_in_object_field_start(void *pstate, char *fname, bool isnull);
 static void jsonb_put_escaped_value(StringInfo out, JsonbValue *scalarVal);
 static void jsonb_in_scalar(void *pstate, char *token, JsonTokenType tokentype);
+static void jsonb_in_scalar_value(char *token, JsonTokenType tokentype,
+								  JsonbValue *v);
+static void jsonb_encode_object_start(void *pstate);
+static void jsonb_encode_array_start(void *pstate);
+static void jsonb_encode_container_end(void *pstate);
+static void jsonb_encode_object_field_start(void *pstate, char *fname,
+											bool isnull);
+static void jsonb_encode_scalar(void *pstate, char *token,
+								JsonTokenType tokentype);
 static void composite_to_jsonb(Datum composite, JsonbInState *result);
+static void jsonb_categorize_attribute(Oid typoid, int *tcategory,
+									   Oid *outfuncoid);
 static void array_dim_to_jsonb(JsonbInState *result, int dim, int ndims, int *dims,
 							   Datum *vals, bool *nulls, int *valcount,
 							   JsonbTypeCategory tcategory, Oid outfuncoid);
@@ -63,6 +75,11 @@ static void array_to_jsonb_internal(Datum array, JsonbInState *result);
 static void datum_to_jsonb(Datum val, bool is_null, JsonbInState *result,
 						   JsonbTypeCategory tcategory, Oid outfuncoid,
 						   bool key_scalar);
+static void datum_to_jsonb_internal(Datum val, bool is_null,
+									JsonbInState *result,
+									JsonbTypeCategory tcategory,
+									Oid outfuncoid, FmgrInfo *outfunc,
+									bool key_scalar);
 static void add_jsonb(Datum val, bool is_null, JsonbInState *result,
 					  Oid val_type, bool key_scalar);
 static JsonbParseState *clone_parse_state(JsonbParseState *state);
@@ -239,34 +256,33 @@ jsonb_typeof(PG_FUNCTION_ARGS)
  *
  * Turns json string into a jsonb Datum.
  *
- * Uses the json parser (with hooks) to construct a jsonb.
+ * Uses the json parser (with hooks) to feed the streaming jsonb encoder, so
+ * no intermediate JsonbValue tree is built.
  */
 static inline Datum
 jsonb_from_cstring(char *json, int len, bool unique_keys)
 {
 	JsonLexContext *lex;
-	JsonbInState state;
+	JsonbEncodeState *state;
 	JsonSemAction sem;
 
-	memset(&state, 0, sizeof(state));
 	memset(&sem, 0, sizeof(sem));
 	lex = makeJsonLexContextCstringLen(json, len, GetDatabaseEncoding(), true);
 
-	state.unique_keys = unique_keys;
+	state = startJsonbEncode(unique_keys);
 
-	sem.semstate = (void *) &state;
+	sem.semstate = (void *) state;
 
-	sem.object_start = jsonb_in_object_start;
-	sem.array_start = jsonb_in_array_start;
-	sem.object_end = jsonb_in_object_end;
-	sem.array_end = jsonb_in_array_end;
-	sem.scalar = jsonb_in_scalar;
-	sem.object_field_start = jsonb_in_object_field_start;
+	sem.object_start = jsonb_encode_object_start;
+	sem.array_start = jsonb_encode_array_start;
+	sem.object_end = jsonb_encode_container_end;
+	sem.array_end = jsonb_encode_container_end;
+	sem.scalar = jsonb_encode_scalar;
+	sem.object_field_start = jsonb_encode_object_field_start;
 
 	pg_parse_json_or_ereport(lex, &sem);
 
-	/* after parsing, the item member has the composed jsonb structure */
-	PG_RETURN_POINTER(JsonbValueToJsonb(state.res));
+	PG_RETURN_POINTER(finishJsonbEncode(state));
 }
 
 static size_t
@@ -341,9 +357,21 @@ jsonb_put_escaped_value(StringInfo out, JsonbValue *scalarVal)
 			escape_json(out, pnstrdup(scalarVal->val.string.val, scalarVal->val.string.len));
 			break;
 		case jbvNumeric:
-			appendStringInfoString(out,
-								   DatumGetCString(DirectFunctionCall1(numeric_out,
-																	   PointerGetDatum(scalarVal->val.numeric))));
+			{
+				int64		val;
+
+				/* print small integers without going through numeric_out */
+				if (numeric_get_int64(scalarVal->val.numeric, &val))
+				{
+					char		buf[MAXINT8LEN + 1];
+
+					appendBinaryStringInfo(out, buf, pg_lltoa(val, buf));
+				}
+				else
+					appendStringInfoString(out,
+										   DatumGetCString(DirectFunctionCall1(numeric_out,
+																			   PointerGetDatum(scalarVal->val.numeric))));
+			}
 			break;
 		case jbvBool:
 			if (scalarVal->val.boolean)
@@ -364,6 +392,46 @@ jsonb_in_scalar(void *pstate, char *token, JsonTokenType tokentype)
 {
 	JsonbInState *_state = (JsonbInState *) pstate;
 	JsonbValue	v;
+
+	jsonb_in_scalar_value(token, tokentype, &v);
+
+	if (_state->parseState == NULL)
+	{
+		/* single scalar */
+		JsonbValue	va;
+
+		va.type = jbvArray;
+		va.val.array.rawScalar = true;
+		va.val.array.nElems = 1;
+
+		_state->res = pushJsonbValue(&_state->parseState, WJB_BEGIN_ARRAY, &va);
+		_state->res = pushJsonbValue(&_state->parseState, WJB_ELEM, &v);
+		_state->res = pushJsonbValue(&_state->parseState, WJB_END_ARRAY, NULL);
+	}
+	else
+	{
+		JsonbValue *o = &_state->parseState->contVal;
+
+		switch (o->type)
+		{
+			case jbvArray:
+				_state->res = pushJsonbValue(&_state->parseState, WJB_ELEM, &v);
+				break;
+			case jbvObject:
+				_state->res = pushJsonbValue(&_state->parseState, WJB_VALUE, &v);
+				break;
+			default:
+				elog(ERROR, "unexpected parent of nested structure");
+		}
+	}
+}
+
+/*
+ * Convert json scalar token into JsonbValue
+ */
+static void
+jsonb_in_scalar_value(char *token, JsonTokenType tokentype, JsonbValue *v)
+{
 	Datum		numd;
 
 	switch (tokentype)
@@ -371,9 +439,9 @@ jsonb_in_scalar(void *pstate, char *token, JsonTokenType tokentype)
 
 		case JSON_TOKEN_STRING:
 			Assert(token != NULL);
-			v.type = jbvString;
-			v.val.string.len = checkStringLen(strlen(token));
-			v.val.string.val = token;
+			v->type = jbvString;
+			v->val.string.len = checkStringLen(strlen(token));
+			v->val.string.val = token;
 			break;
 		case JSON_TOKEN_NUMBER:
 
@@ -382,59 +450,76 @@ jsonb_in_scalar(void *pstate, char *token, JsonTokenType tokentype)
 			 * numeric size is well below the JsonbValue restriction
 			 */
 			Assert(token != NULL);
-			v.type = jbvNumeric;
+			v->type = jbvNumeric;
 			numd = DirectFunctionCall3(numeric_in,
 									   CStringGetDatum(token),
 									   ObjectIdGetDatum(InvalidOid),
 									   Int32GetDatum(-1));
-			v.val.numeric = DatumGetNumeric(numd);
+			v->val.numeric = DatumGetNumeric(numd);
 			break;
 		case JSON_TOKEN_TRUE:
-			v.type = jbvBool;
-			v.val.boolean = true;
+			v->type = jbvBool;
+			v->val.boolean = true;
 			break;
 		case JSON_TOKEN_FALSE:
-			v.type = jbvBool;
-			v.val.boolean = false;
+			v->type = jbvBool;
+			v->val.boolean = false;
 			break;
 		case JSON_TOKEN_NULL:
-			v.type = jbvNull;
+			v->type = jbvNull;
 			break;
 		default:
 			/* should not be possible */
 			elog(ERROR, "invalid json token type");
 			break;
 	}
+}
 
-	if (_state->parseState == NULL)
-	{
-		/* single scalar */
-		JsonbValue	va;
+/*
+ * Semantic actions feeding the streaming jsonb encoder.  Unlike the jsonb_in_*
+ * ones, these immediately copy the tokens into the encoder and free them.
+ */
+static void
+jsonb_encode_object_start(void *pstate)
+{
+	encodeJsonbBeginContainer((JsonbEncodeState *) pstate, true);
+}
 
-		va.type = jbvArray;
-		va.val.array.rawScalar = true;
-		va.val.array.nElems = 1;
+static void
+jsonb_encode_array_start(void *pstate)
+{
+	encodeJsonbBeginContainer((JsonbEncodeState *) pstate, false);
+}
 
-		_state->res = pushJsonbValue(&_state->parseState, WJB_BEGIN_ARRAY, &va);
-		_state->res = pushJsonbValue(&_state->parseState, WJB_ELEM, &v);
-		_state->res = pushJsonbValue(&_state->parseState, WJB_END_ARRAY, NULL);
-	}
-	else
-	{
-		JsonbValue *o = &_state->parseState->contVal;
+static void
+jsonb_encode_container_end(void *pstate)
+{
+	encodeJsonbEndContainer((JsonbEncodeState *) pstate);
+}
 
-		switch (o->type)
-		{
-			case jbvArray:
-				_state->res = pushJsonbValue(&_state->parseState, WJB_ELEM, &v);
-				break;
-			case jbvObject:
-				_state->res = pushJsonbValue(&_state->parseState, WJB_VALUE, &v);
-				break;
-			default:
-				elog(ERROR, "unexpected parent of nested structure");
-		}
-	}
+static void
+jsonb_encode_object_field_start(void *pstate, char *fname, bool isnull)
+{
+	Assert(fname != NULL);
+
+	encodeJsonbKey((JsonbEncodeState *) pstate, fname,
+				   checkStringLen(strlen(fname)));
+	pfree(fname);
+}
+
+static void
+jsonb_encode_scalar(void *pstate, char *token, JsonTokenType tokentype)
+{
+	JsonbValue	v;
+
+	jsonb_in_scalar_value(token, tokentype, &v);
+
+	encodeJsonbScalar((JsonbEncodeState *) pstate, &v);
+
+	if (v.type == jbvNumeric)
+		pfree(v.val.numeric);
+	if (token)
+		pfree(token);
 }
 
 /*
@@ -723,6 +808,19 @@ static void
 datum_to_jsonb(Datum val, bool is_null, JsonbInState *result,
 			   JsonbTypeCategory tcategory, Oid outfuncoid,
 			   bool key_scalar)
+{
+	datum_to_jsonb_internal(val, is_null, result, tcategory, outfuncoid, NULL,
+							key_scalar);
+}
+
+/*
+ * Workhorse for datum_to_jsonb.  If "outfunc" is not NULL, it is the lookup
+ * info of outfuncoid, which saves looking it up for each value.
+ */
+static void
+datum_to_jsonb_internal(Datum val, bool is_null, JsonbInState *result,
+						JsonbTypeCategory tcategory, Oid outfuncoid,
+						FmgrInfo *outfunc, bool key_scalar)
 {
 	char	   *outputstr;
 	bool		numeric_error;
@@ -751,7 +849,8 @@ datum_to_jsonb(Datum val, bool is_null, JsonbInState *result,
 	else
 	{
 		if (tcategory == JSONBTYPE_JSONCAST)
-			val = OidFunctionCall1(outfuncoid, val);
+			val = outfunc ? FunctionCall1(outfunc, val) :
+				OidFunctionCall1(outfuncoid, val);
 
 		switch (tcategory)
 		{
@@ -776,7 +875,8 @@ datum_to_jsonb(Datum val, bool is_null, JsonbInState *result,
 				}
 				break;
 			case JSONBTYPE_NUMERIC:
-				outputstr = OidOutputFunctionCall(outfuncoid, val);
+				outputstr = outfunc ? OutputFunctionCall(outfunc, val) :
+					OidOutputFunctionCall(outfuncoid, val);
 				if (key_scalar)
 				{
 					/* always quote keys */
@@ -889,7 +989,8 @@ datum_to_jsonb(Datum val, bool is_null, JsonbInState *result,
 				}
 				break;
 			default:
-				outputstr = OidOutputFunctionCall(outfuncoid, val);
+				outputstr = outfunc ? OutputFunctionCall(outfunc, val) :
+					OidOutputFunctionCall(outfuncoid, val);
 				jb.type = jbvString;
 				jb.val.string.len = checkStringLen(strlen(outputstr));
 				jb.val.string.val = outputstr;
@@ -1029,6 +1130,7 @@ composite_to_jsonb(Datum composite, JsonbInState *result)
 	Oid			tupType;
 	int32		tupTypmod;
 	TupleDesc	tupdesc;
+	JsonCompositePlan *plan;
 	HeapTupleData tmptup,
 			   *tuple;
 	int			i;
@@ -1039,53 +1141,75 @@ composite_to_jsonb(Datum composite, JsonbInState *result)
 	tupType = HeapTupleHeaderGetTypeId(td);
 	tupTypmod = HeapTupleHeaderGetTypMod(td);
 	tupdesc = lookup_rowtype_tupdesc(tupType, tupTypmod);
+	plan = json_composite_plan_acquire(tupdesc, true,
+									   jsonb_categorize_attribute);
 
 	/* Build a temporary HeapTuple control structure */
 	tmptup.t_len = HeapTupleHeaderGetDatumLength(td);
 	tmptup.t_data = td;
 	tuple = &tmptup;
 
-	result->res = pushJsonbValue(&result->parseState, WJB_BEGIN_OBJECT, NULL);
-
-	for (i = 0; i < tupdesc->natts; i++)
+	/* the plan must be released on error too, or it can never be freed */
+	PG_TRY();
 	{
-		Datum		val;
-		bool		isnull;
-		char	   *attname;
-		JsonbTypeCategory tcategory;
-		Oid			outfuncoid;
-		JsonbValue	v;
-		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
-
-		if (att->attisdropped)
-			continue;
+		result->res = pushJsonbValue(&result->parseState, WJB_BEGIN_OBJECT,
+									 NULL);
 
-		attname = NameStr(att->attname);
+		for (i = 0; i < plan->ncolumns; i++)
+		{
+			JsonCompositeColumn *col = &plan->columns[i];
+			Datum		val;
+			bool		isnull;
+			JsonbValue	v;
 
-		v.type = jbvString;
-		/* don't need checkStringLen here - can't exceed maximum name length */
-		v.val.string.len = strlen(attname);
-		v.val.string.val = attname;
+			/*
+			 * The key is referenced until the whole result is built, which
+			 * may be after the plan is gone, so it must be copied.
+			 */
+			v.type = jbvString;
+			v.val.string.len = col->keylen;
+			v.val.string.val = pnstrdup(col->key, col->keylen);
 
-		result->res = pushJsonbValue(&result->parseState, WJB_KEY, &v);
+			result->res = pushJsonbValue(&result->parseState, WJB_KEY, &v);
 
-		val = heap_getattr(tuple, i + 1, tupdesc, &isnull);
+			val = heap_getattr(tuple, col->attnum, tupdesc, &isnull);
 
-		if (isnull)
-		{
-			tcategory = JSONBTYPE_NULL;
-			outfuncoid = InvalidOid;
+			if (isnull)
+				datum_to_jsonb_internal(val, true, result, JSONBTYPE_NULL,
+										InvalidOid, NULL, false);
+			else
+				datum_to_jsonb_internal(val, false, result,
+										(JsonbTypeCategory) col->tcategory,
+										col->outfuncoid,
+										OidIsValid(col->outfuncoid) ?
+										&col->outfunc : NULL,
+										false);
 		}
-		else
-			jsonb_categorize_type(att->atttypid, &tcategory, &outfuncoid);
 
-		datum_to_jsonb(val, isnull, result, tcategory, outfuncoid, false);
+		result->res = pushJsonbValue(&result->parseState, WJB_END_OBJECT,
+									 NULL);
+	}
+	PG_FINALLY();
+	{
+		json_composite_plan_release(plan);
 	}
+	PG_END_TRY();
 
-	result->res = pushJsonbValue(&result->parseState, WJB_END_OBJECT, NULL);
 	ReleaseTupleDesc(tupdesc);
 }
 
+/*
+ * jsonb_categorize_type() as a JsonCategorizeTypeFunc
+ */
+static void
+jsonb_categorize_attribute(Oid typoid, int *tcategory, Oid *outfuncoid)
+{
+	JsonbTypeCategory category;
+
+	jsonb_categorize_type(typoid, &category, outfuncoid);
+	*tcategory = (int) category;
+}
+
 /*
  * Append JSON text for "val" to "result".
  *
@@ -1572,14 +1696,8 @@ jsonb_agg_transfn_worker(FunctionCallInfo fcinfo, bool absent_on_null)
 	MemoryContext oldcontext,
 				aggcontext;
 	JsonbAggState *state;
-	JsonbInState elem;
 	Datum		val;
-	JsonbInState *result;
-	bool		single_scalar = false;
-	JsonbIterator *it;
 	Jsonb	   *jbelem;
-	JsonbValue	v;
-	JsonbIteratorToken type;
 
 	if (!AggCheckCallContext(fcinfo, &aggcontext))
 	{
@@ -1599,21 +1717,16 @@ jsonb_agg_transfn_worker(FunctionCallInfo fcinfo, bool absent_on_null)
 					 errmsg("could not determine input data type")));
 
 		oldcontext = MemoryContextSwitchTo(aggcontext);
-		state = palloc(sizeof(JsonbAggState));
-		result = palloc0(sizeof(JsonbInState));
-		state->res = result;
-		result->res = pushJsonbValue(&result->parseState,
-									 WJB_BEGIN_ARRAY, NULL);
+		state = palloc0(sizeof(JsonbAggState));
+		state->encoder = startJsonbEncode(false);
+		encodeJsonbBeginContainer(state->encoder, false);
 		MemoryContextSwitchTo(oldcontext);
 
 		jsonb_categorize_type(arg_type, &state->val_category,
 							  &state->val_output_func);
 	}
 	else
-	{
 		state = (JsonbAggState *) PG_GETARG_POINTER(0);
-		result = state->res;
-	}
 
 	if (absent_on_null && PG_ARGISNULL(1))
 		PG_RETURN_POINTER(state);
@@ -1622,67 +1735,25 @@ jsonb_agg_transfn_worker(FunctionCallInfo fcinfo, bool absent_on_null)
 
 	val = PG_ARGISNULL(1) ? (Datum) 0 : PG_GETARG_DATUM(1);
 
-	memset(&elem, 0, sizeof(JsonbInState));
-
-	datum_to_jsonb(val, PG_ARGISNULL(1), &elem, state->val_category,
-				   state->val_output_func, false);
-
-	jbelem = JsonbValueToJsonb(elem.res);
-
-	/* switch to the aggregate context for accumulation operations */
+	if (state->val_category == JSONBTYPE_JSONB && !PG_ARGISNULL(1))
+		jbelem = DatumGetJsonbP(val);
+	else
+	{
+		JsonbInState elem;
 
-	oldcontext = MemoryContextSwitchTo(aggcontext);
+		memset(&elem, 0, sizeof(JsonbInState));
 
-	it = JsonbIteratorInit(&jbelem->root);
+		datum_to_jsonb(val, PG_ARGISNULL(1), &elem, state->val_category,
+					   state->val_output_func, false);
 
-	while ((type = JsonbIteratorNext(&it, &v, false)) != WJB_DONE)
-	{
-		switch (type)
-		{
-			case WJB_BEGIN_ARRAY:
-				if (v.val.array.rawScalar)
-					single_scalar = true;
-				else
-					result->res = pushJsonbValue(&result->parseState,
-												 type, NULL);
-				break;
-			case WJB_END_ARRAY:
-				if (!single_scalar)
-					result->res = pushJsonbValue(&result->parseState,
-												 type, NULL);
-				break;
-			case WJB_BEGIN_OBJECT:
-			case WJB_END_OBJECT:
-				result->res = pushJsonbValue(&result->parseState,
-											 type, NULL);
-				break;
-			case WJB_ELEM:
-			case WJB_KEY:
-			case WJB_VALUE:
-				if (v.type == jbvString)
-				{
-					/* copy string values in the aggregate context */
-					char	   *buf = palloc(v.val.string.len + 1);
-
-					snprintf(buf, v.val.string.len + 1, "%s", v.val.string.val);
-					v.val.string.val = buf;
-				}
-				else if (v.type == jbvNumeric)
-				{
-					/* same for numeric */
-					v.val.numeric =
-						DatumGetNumeric(DirectFunctionCall1(numeric_uplus,
-															NumericGetDatum(v.val.numeric)));
-				}
-				result->res = pushJsonbValue(&result->parseState,
-											 type, &v);
-				break;
-			default:
-				elog(ERROR, "unknown jsonb iterator token type");
-		}
+		jbelem = JsonbValueToJsonb(elem.res);
 	}
 
-	MemoryContextSwitchTo(oldcontext);
+	/*
+	 * Append the binary representation of the element to the accumulated
+	 * array as is.  The encoder's buffers live in the aggregate context.
+	 */
+	encodeJsonbBinary(state->encoder, jbelem);
 
 	PG_RETURN_POINTER(state);
 }
@@ -1705,11 +1776,55 @@ jsonb_agg_strict_transfn(PG_FUNCTION_ARGS)
 	return jsonb_agg_transfn_worker(fcinfo, true);
 }
 
+static Datum
+jsonb_agg_invtransfn_worker(FunctionCallInfo fcinfo, bool absent_on_null)
+{
+	JsonbAggState *state;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+	{
+		/* cannot be called directly because of internal-type argument */
+		elog(ERROR, "jsonb_agg_invtransfn called in non-aggregate context");
+	}
+
+	/* the state is never NULL in moving-aggregate mode */
+	Assert(!PG_ARGISNULL(0));
+
+	state = (JsonbAggState *) PG_GETARG_POINTER(0);
+
+	/*
+	 * The inverse transition function is called for the rows in the order
+	 * they were added, so the value to remove is the first element.  Nulls
+	 * were not added by jsonb_agg_strict.
+	 */
+	if (!(absent_on_null && PG_ARGISNULL(1)))
+		encodeJsonbRemoveFirst(state->encoder);
+
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * jsonb_agg inverse transition function
+ */
+Datum
+jsonb_agg_invtransfn(PG_FUNCTION_ARGS)
+{
+	return jsonb_agg_invtransfn_worker(fcinfo, false);
+}
+
+/*
+ * jsonb_agg_strict inverse transition function
+ */
+Datum
+jsonb_agg_strict_invtransfn(PG_FUNCTION_ARGS)
+{
+	return jsonb_agg_invtransfn_worker(fcinfo, true);
+}
+
 Datum
 jsonb_agg_finalfn(PG_FUNCTION_ARGS)
 {
 	JsonbAggState *arg;
-	JsonbInState result;
 	Jsonb	   *out;
 
 	/* cannot be called directly because of internal-type argument */
@@ -1721,18 +1836,10 @@ jsonb_agg_finalfn(PG_FUNCTION_ARGS)
 	arg = (JsonbAggState *) PG_GETARG_POINTER(0);
 
 	/*
-	 * We need to do a shallow clone of the argument in case the final
-	 * function is called more than once, so we avoid changing the argument. A
-	 * shallow clone is sufficient as we aren't going to change any of the
-	 * values, just add the final array end marker.
+	 * The final function may be called more than once, so assemble the
+	 * result without closing the array in the accumulator.
 	 */
-
-	result.parseState = clone_parse_state(arg->res->parseState);
-
-	result.res = pushJsonbValue(&result.parseState,
-								WJB_END_ARRAY, NULL);
-
-	out = JsonbValueToJsonb(result.res);
+	out = peekJsonbEncode(arg->encoder);
 
 	PG_RETURN_POINTER(out);
 }
@@ -1366,6 +1366,7 @@ make_scalar_key(const JsonbValue *scalarVal, bool is_key)
 {
 	Datum		item;
 	char	   *cstr;
+	int64		ival;
 
 	switch (scalarVal->type)
 	{
@@ -1391,6 +1392,15 @@ make_scalar_key(const JsonbValue *scalarVal, bool is_key)
 			 * storing a "union" type in the GIN B-Tree, and indexing Jsonb
 			 * strings takes precedence.
 			 */
+			if (numeric_get_int64(scalarVal->val.numeric, &ival))
+			{
+				/* small integers are already in normal form */
+				char		buf[MAXINT8LEN + 1];
+
+				item = make_text_key(JGINFLAG_NUM, buf, pg_lltoa(ival, buf));
+				break;
+			}
+
 			cstr = numeric_normalize(scalarVal->val.numeric);
 			item = make_text_key(JGINFLAG_NUM, cstr, strlen(cstr));
 			pfree(cstr);
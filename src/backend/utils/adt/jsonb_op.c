@@ -14,9 +14,29 @@
 #include "postgres.h"
 
 #include "catalog/pg_type.h"
+#include "common/hashfn.h"
+#include "lib/hyperloglog.h"
 #include "miscadmin.h"
 #include "utils/builtins.h"
+#include "utils/guc.h"
 #include "utils/jsonb.h"
+#include "utils/sortsupport.h"
+
+/* sortsupport for jsonb */
+typedef struct
+{
+	int64		input_count;	/* number of non-null values seen */
+	bool		estimating;		/* true if estimating cardinality */
+
+	hyperLogLogState abbr_card; /* cardinality estimator */
+} jsonb_sortsupport_state;
+
+static int	jsonb_fast_cmp(Datum x, Datum y, SortSupport ssup);
+#if SIZEOF_DATUM == 8
+static int	jsonb_cmp_abbrev(Datum x, Datum y, SortSupport ssup);
+static bool jsonb_abbrev_abort(int memtupcount, SortSupport ssup);
+static Datum jsonb_abbrev_convert(Datum original, SortSupport ssup);
+#endif
 
 Datum
 jsonb_exists(PG_FUNCTION_ARGS)
@@ -153,7 +173,7 @@ jsonb_ne(PG_FUNCTION_ARGS)
 	Jsonb	   *jbb = PG_GETARG_JSONB_P(1);
 	bool		res;
 
-	res = (compareJsonbContainers(&jba->root, &jbb->root) != 0);
+	res = !equalsJsonb(jba, jbb);
 
 	PG_FREE_IF_COPY(jba, 0);
 	PG_FREE_IF_COPY(jbb, 1);
@@ -226,7 +246,7 @@ jsonb_eq(PG_FUNCTION_ARGS)
 	Jsonb	   *jbb = PG_GETARG_JSONB_P(1);
 	bool		res;
 
-	res = (compareJsonbContainers(&jba->root, &jbb->root) == 0);
+	res = equalsJsonb(jba, jbb);
 
 	PG_FREE_IF_COPY(jba, 0);
 	PG_FREE_IF_COPY(jbb, 1);
@@ -247,6 +267,180 @@ jsonb_cmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(res);
 }
 
+/*
+ * Sort support strategy routine
+ */
+Datum
+jsonb_sortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+
+	ssup->comparator = jsonb_fast_cmp;
+	ssup->ssup_extra = NULL;
+
+	/*
+	 * Abbreviated keys are prefixes computed by getJsonbSortPrefix(), which
+	 * only fit in a 64-bit Datum.
+	 */
+#if SIZEOF_DATUM == 8
+	if (ssup->abbreviate)
+	{
+		jsonb_sortsupport_state *jss;
+		MemoryContext oldcontext;
+
+		oldcontext = MemoryContextSwitchTo(ssup->ssup_cxt);
+
+		jss = palloc(sizeof(jsonb_sortsupport_state));
+		jss->input_count = 0;
+		jss->estimating = true;
+		initHyperLogLog(&jss->abbr_card, 10);
+
+		ssup->ssup_extra = jss;
+
+		ssup->comparator = jsonb_cmp_abbrev;
+		ssup->abbrev_converter = jsonb_abbrev_convert;
+		ssup->abbrev_abort = jsonb_abbrev_abort;
+		ssup->abbrev_full_comparator = jsonb_fast_cmp;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+#endif
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * SortSupport comparison func
+ */
+static int
+jsonb_fast_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	Jsonb	   *jba = DatumGetJsonbP(x);
+	Jsonb	   *jbb = DatumGetJsonbP(y);
+	int			res;
+
+	res = compareJsonbContainers(&jba->root, &jbb->root);
+
+	/* We can't afford to leak memory here. */
+	if (PointerGetDatum(jba) != x)
+		pfree(jba);
+	if (PointerGetDatum(jbb) != y)
+		pfree(jbb);
+
+	return res;
+}
+
+#if SIZEOF_DATUM == 8
+
+/*
+ * Abbreviated key comparison func
+ */
+static int
+jsonb_cmp_abbrev(Datum x, Datum y, SortSupport ssup)
+{
+	if (x > y)
+		return 1;
+	else if (x == y)
+		return 0;
+	else
+		return -1;
+}
+
+/*
+ * Callback for estimating effectiveness of abbreviated key optimization.
+ *
+ * The prefixes only tell apart documents of different shapes and arrays with
+ * different first scalars, so abbreviation is abandoned for columns whose
+ * documents are all alike, such as objects with a fixed set of keys.
+ */
+static bool
+jsonb_abbrev_abort(int memtupcount, SortSupport ssup)
+{
+	jsonb_sortsupport_state *jss = ssup->ssup_extra;
+	double		abbr_card;
+
+	if (memtupcount < 10000 || jss->input_count < 10000 || !jss->estimating)
+		return false;
+
+	abbr_card = estimateHyperLogLog(&jss->abbr_card);
+
+	/*
+	 * If we have >100k distinct values, then even if we were sorting many
+	 * billion rows we'd likely still break even, and the penalty of undoing
+	 * that many rows of abbrevs would probably not be worth it.  Stop even
+	 * counting at that point.
+	 */
+	if (abbr_card > 100000.0)
+	{
+#ifdef TRACE_SORT
+		if (trace_sort)
+			elog(LOG,
+				 "jsonb_abbrev: estimation ends at cardinality %f"
+				 " after " INT64_FORMAT " values (%d rows)",
+				 abbr_card, jss->input_count, memtupcount);
+#endif
+		jss->estimating = false;
+		return false;
+	}
+
+	/*
+	 * Target minimum cardinality is 1 per ~2k of non-null inputs.  0.5 row
+	 * fudge factor allows us to abort earlier on genuinely pathological data
+	 * where we've had exactly one abbreviated value in the first 2k
+	 * (non-null) rows.
+	 */
+	if (abbr_card < jss->input_count / 2000.0 + 0.5)
+	{
+#ifdef TRACE_SORT
+		if (trace_sort)
+			elog(LOG,
+				 "jsonb_abbrev: aborting abbreviation at cardinality %f"
+				 " below threshold %f after " INT64_FORMAT " values (%d rows)",
+				 abbr_card, jss->input_count / 2000.0 + 0.5, jss->input_count,
+				 memtupcount);
+#endif
+		return true;
+	}
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG,
+			 "jsonb_abbrev: cardinality %f after " INT64_FORMAT
+			 " values (%d rows)", abbr_card, jss->input_count, memtupcount);
+#endif
+
+	return false;
+}
+
+/*
+ * Conversion routine for sortsupport.  The abbreviated key is the prefix
+ * computed by getJsonbSortPrefix(), treated as an unsigned integer.
+ */
+static Datum
+jsonb_abbrev_convert(Datum original, SortSupport ssup)
+{
+	jsonb_sortsupport_state *jss = ssup->ssup_extra;
+	Jsonb	   *authoritative = DatumGetJsonbP(original);
+	uint64		res;
+
+	res = getJsonbSortPrefix(&authoritative->root);
+	jss->input_count += 1;
+
+	if (jss->estimating)
+	{
+		uint32		tmp = (uint32) res ^ (uint32) (res >> 32);
+
+		addHyperLogLog(&jss->abbr_card, DatumGetUInt32(hash_uint32(tmp)));
+	}
+
+	if (PointerGetDatum(authoritative) != original)
+		pfree(authoritative);
+
+	return (Datum) res;
+}
+
+#endif							/* SIZEOF_DATUM == 8 */
+
 /*
  * Hash operator class jsonb hashing function
  */
@@ -37,16 +37,77 @@
 #define JSONB_MAX_ELEMS (Min(MaxAllocSize / sizeof(JsonbValue), JB_CMASK))
 #define JSONB_MAX_PAIRS (Min(MaxAllocSize / sizeof(JsonbPair), JB_CMASK))
 
+/*
+ * Streaming encoder of Jsonb.
+ *
+ * Unlike pushJsonbValue() followed by JsonbValueToJsonb(), this does not
+ * build an in-memory JsonbValue tree.  Scalars are encoded into the data
+ * buffer as soon as they are passed, and each container is assembled into
+ * its final binary form as soon as it is closed.  The only deferred work is
+ * sorting and de-duplication of object keys, which needs all the pairs of
+ * the object.
+ *
+ * The children of all currently open containers are kept in a single data
+ * buffer and a single array of entries, both used as stacks.  Data of a
+ * child is stored without alignment padding; the padding is inserted when
+ * the parent container is assembled, because it depends on the final
+ * position of the child, which is not known for object values until the
+ * keys are sorted.
+ */
+typedef struct JsonbEncodeEntry
+{
+	JEntry		meta;			/* JENTRY_IS* type bits */
+	bool		align;			/* data should be int-aligned */
+	int			offset;			/* offset of data in JsonbEncodeState.data */
+	int			len;			/* length of data, not including padding */
+} JsonbEncodeEntry;
+
+typedef struct JsonbEncodeLevel
+{
+	bool		isObject;
+	bool		rawScalar;
+	int			firstEntry;		/* index of the entry of the first child */
+	int			dataStart;		/* offset of the data of the first child */
+} JsonbEncodeLevel;
+
+struct JsonbEncodeState
+{
+	StringInfoData data;		/* data of children of open containers */
+	StringInfoData container;	/* buffer for assembling a closed container */
+	JsonbEncodeEntry *entries;	/* children of open containers */
+	int			nentries;
+	int			entriesSize;
+	JsonbEncodeLevel *levels;	/* stack of open containers */
+	int			nlevels;
+	int			levelsSize;
+	bool		unique_keys;	/* error out on duplicate object keys */
+	bool		noncanonical;	/* result can't be marked JB_FCANONICAL */
+	Jsonb	   *result;			/* result, when the root container is closed */
+};
+
+/* Argument of lengthCompareJsonbEncodePair() */
+typedef struct JsonbEncodePairsCompareArg
+{
+	JsonbEncodeState *state;
+	JsonbEncodeEntry *pairs;	/* interleaved key and value entries */
+	bool		hasNonUniq;
+} JsonbEncodePairsCompareArg;
+
 static void fillJsonbValue(JsonbContainer *container, int index,
 						   char *base_addr, uint32 offset,
 						   JsonbValue *result);
 static bool equalsJsonbScalarValue(JsonbValue *a, JsonbValue *b);
 static int	compareJsonbScalarValue(JsonbValue *a, JsonbValue *b);
+static int	compareJsonbChildValues(JsonbValue *va, JsonbValue *vb);
 static Jsonb *convertToJsonb(JsonbValue *val);
-static void convertJsonbValue(StringInfo buffer, JEntry *header, JsonbValue *val, int level);
-static void convertJsonbArray(StringInfo buffer, JEntry *header, JsonbValue *val, int level);
-static void convertJsonbObject(StringInfo buffer, JEntry *header, JsonbValue *val, int level);
-static void convertJsonbScalar(StringInfo buffer, JEntry *header, JsonbValue *scalarVal);
+static void convertJsonbValue(StringInfo buffer, JEntry *header, JsonbValue *val,
+							  int level, bool *canonical);
+static void convertJsonbArray(StringInfo buffer, JEntry *header, JsonbValue *val,
+							  int level, bool *canonical);
+static void convertJsonbObject(StringInfo buffer, JEntry *header, JsonbValue *val,
+							   int level, bool *canonical);
+static void convertJsonbScalar(StringInfo buffer, JEntry *header, JsonbValue *scalarVal,
+							   bool *canonical);
 
 static int	reserveFromBuffer(StringInfo buffer, int len);
 static void appendToBuffer(StringInfo buffer, const char *data, int len);
@@ -68,6 +129,21 @@ static void uniqueifyJsonbObject(JsonbValue *object, bool unique_keys,
 static JsonbValue *pushJsonbValueScalar(JsonbParseState **pstate,
 										JsonbIteratorToken seq,
 										JsonbValue *scalarVal);
+static void encodeJsonbPushLevel(JsonbEncodeState *state, bool isObject,
+								 bool rawScalar);
+static JsonbEncodeEntry *encodeJsonbNewEntry(JsonbEncodeState *state);
+static JsonbEncodeEntry *encodeJsonbNewValueEntry(JsonbEncodeState *state);
+static JEntry encodeJsonbChild(JsonbEncodeState *state, StringInfo buffer,
+							   JsonbEncodeEntry *child);
+static void encodeJsonbContainer(JsonbEncodeState *state, StringInfo buffer,
+								 JsonbEncodeLevel *level);
+static void encodeJsonbArray(JsonbEncodeState *state, StringInfo buffer,
+							 JsonbEncodeEntry *elems, int nElems,
+							 bool rawScalar);
+static void encodeJsonbObject(JsonbEncodeState *state, StringInfo buffer,
+							  JsonbEncodeEntry *pairs, int nPairs);
+static int	lengthCompareJsonbEncodePair(const void *a, const void *b,
+										 void *arg);
 
 /*
  * Turn an in-memory JsonbValue into a Jsonb for on-disk storage.
@@ -180,132 +256,198 @@ getJsonbLength(const JsonbContainer *jc, int index)
  * much simpler comparator logic for searching through Strings.  Since this is
  * called from B-Tree support function 1, we're careful about not leaking
  * memory here.
+ *
+ * The containers are compared in the order a JsonbIterator would return their
+ * tokens: first the container type and size, then array elements, or object
+ * keys each followed by its value, recursing into nested containers.  The
+ * children are accessed directly rather than through iterators, which would
+ * need an allocation per container.
  */
 int
 compareJsonbContainers(JsonbContainer *a, JsonbContainer *b)
 {
-	JsonbIterator *ita,
-			   *itb;
-	int			res = 0;
+	uint32		count = JsonContainerSize(a);
+	uint32		nchildren;
+	char	   *base_addr_a;
+	char	   *base_addr_b;
+	uint32		offset_a = 0;
+	uint32		offset_b = 0;
+	uint32		value_offset_a = 0;
+	uint32		value_offset_b = 0;
+	bool		isObject = JsonContainerIsObject(a);
+	uint32		i;
 
-	ita = JsonbIteratorInit(a);
-	itb = JsonbIteratorInit(b);
+	check_stack_depth();
 
-	do
-	{
-		JsonbValue	va,
-					vb;
-		JsonbIteratorToken ra,
-					rb;
+	/* Type-defined order: objects sort after arrays */
+	if (isObject != JsonContainerIsObject(b))
+		return isObject ? 1 : -1;
 
-		ra = JsonbIteratorNext(&ita, &va, false);
-		rb = JsonbIteratorNext(&itb, &vb, false);
+	if (count != JsonContainerSize(b))
+		return count > JsonContainerSize(b) ? 1 : -1;
 
-		if (ra == rb)
-		{
-			if (ra == WJB_DONE)
-			{
-				/* Decisively equal */
-				break;
-			}
+	/*
+	 * This could be a "raw scalar" pseudo array.  As far as we're concerned
+	 * it's just a scalar, but it sorts before a one-element array.
+	 */
+	if (JsonContainerIsScalar(a) != JsonContainerIsScalar(b))
+		return JsonContainerIsScalar(a) ? -1 : 1;
 
-			if (ra == WJB_END_ARRAY || ra == WJB_END_OBJECT)
-			{
-				/*
-				 * There is no array or object to compare at this stage of
-				 * processing.  jbvArray/jbvObject values are compared
-				 * initially, at the WJB_BEGIN_ARRAY and WJB_BEGIN_OBJECT
-				 * tokens.
-				 */
-				continue;
-			}
+	nchildren = isObject ? count * 2 : count;
+	base_addr_a = (char *) &a->children[nchildren];
+	base_addr_b = (char *) &b->children[nchildren];
 
-			if (va.type == vb.type)
-			{
-				switch (va.type)
-				{
-					case jbvString:
-					case jbvNull:
-					case jbvNumeric:
-					case jbvBool:
-						res = compareJsonbScalarValue(&va, &vb);
-						break;
-					case jbvArray:
-
-						/*
-						 * This could be a "raw scalar" pseudo array.  That's
-						 * a special case here though, since we still want the
-						 * general type-based comparisons to apply, and as far
-						 * as we're concerned a pseudo array is just a scalar.
-						 */
-						if (va.val.array.rawScalar != vb.val.array.rawScalar)
-							res = (va.val.array.rawScalar) ? -1 : 1;
-						if (va.val.array.nElems != vb.val.array.nElems)
-							res = (va.val.array.nElems > vb.val.array.nElems) ? 1 : -1;
-						break;
-					case jbvObject:
-						if (va.val.object.nPairs != vb.val.object.nPairs)
-							res = (va.val.object.nPairs > vb.val.object.nPairs) ? 1 : -1;
-						break;
-					case jbvBinary:
-						elog(ERROR, "unexpected jbvBinary value");
-						break;
-					case jbvDatetime:
-						elog(ERROR, "unexpected jbvDatetime value");
-						break;
-				}
-			}
-			else
-			{
-				/* Type-defined order */
-				res = (va.type > vb.type) ? 1 : -1;
-			}
-		}
-		else
-		{
-			/*
-			 * It's safe to assume that the types differed, and that the va
-			 * and vb values passed were set.
-			 *
-			 * If the two values were of the same container type, then there'd
-			 * have been a chance to observe the variation in the number of
-			 * elements/pairs (when processing WJB_BEGIN_OBJECT, say). They're
-			 * either two heterogeneously-typed containers, or a container and
-			 * some scalar type.
-			 *
-			 * We don't have to consider the WJB_END_ARRAY and WJB_END_OBJECT
-			 * cases here, because we would have seen the corresponding
-			 * WJB_BEGIN_ARRAY and WJB_BEGIN_OBJECT tokens first, and
-			 * concluded that they don't match.
-			 */
-			Assert(ra != WJB_END_ARRAY && ra != WJB_END_OBJECT);
-			Assert(rb != WJB_END_ARRAY && rb != WJB_END_OBJECT);
-
-			Assert(va.type != vb.type);
-			Assert(va.type != jbvBinary);
-			Assert(vb.type != jbvBinary);
-			/* Type-defined order */
-			res = (va.type > vb.type) ? 1 : -1;
-		}
+	if (isObject)
+	{
+		value_offset_a = getJsonbOffset(a, count);
+		value_offset_b = getJsonbOffset(b, count);
 	}
-	while (res == 0);
 
-	while (ita != NULL)
+	for (i = 0; i < count; i++)
 	{
-		JsonbIterator *i = ita->parent;
+		JsonbValue	va;
+		JsonbValue	vb;
+		int			res;
+
+		/* array element or object key */
+		fillJsonbValue(a, i, base_addr_a, offset_a, &va);
+		fillJsonbValue(b, i, base_addr_b, offset_b, &vb);
+
+		res = compareJsonbChildValues(&va, &vb);
+		if (res != 0)
+			return res;
+
+		JBE_ADVANCE_OFFSET(offset_a, a->children[i]);
+		JBE_ADVANCE_OFFSET(offset_b, b->children[i]);
+
+		if (!isObject)
+			continue;
+
+		/* object value */
+		fillJsonbValue(a, i + count, base_addr_a, value_offset_a, &va);
+		fillJsonbValue(b, i + count, base_addr_b, value_offset_b, &vb);
+
+		res = compareJsonbChildValues(&va, &vb);
+		if (res != 0)
+			return res;
 
-		pfree(ita);
-		ita = i;
+		JBE_ADVANCE_OFFSET(value_offset_a, a->children[i + count]);
+		JBE_ADVANCE_OFFSET(value_offset_b, b->children[i + count]);
 	}
-	while (itb != NULL)
-	{
-		JsonbIterator *i = itb->parent;
 
-		pfree(itb);
-		itb = i;
+	return 0;
+}
+
+/*
+ * Compare two children of containers for compareJsonbContainers().
+ */
+static int
+compareJsonbChildValues(JsonbValue *va, JsonbValue *vb)
+{
+	enum jbvType ta = va->type;
+	enum jbvType tb = vb->type;
+
+	if (ta == jbvBinary && tb == jbvBinary)
+		return compareJsonbContainers(va->val.binary.data,
+									  vb->val.binary.data);
+
+	if (ta == jbvBinary)
+		ta = JsonContainerIsObject(va->val.binary.data) ? jbvObject : jbvArray;
+	if (tb == jbvBinary)
+		tb = JsonContainerIsObject(vb->val.binary.data) ? jbvObject : jbvArray;
+
+	/* Type-defined order */
+	if (ta != tb)
+		return ta > tb ? 1 : -1;
+
+	return compareJsonbScalarValue(va, vb);
+}
+
+/*
+ * Are two Jsonb values equal?  Values with identical binary representations
+ * are always equal, and if both are in canonical form (see JB_FCANONICAL),
+ * the reverse holds too, so the containers only have to be walked when the
+ * bytes differ and at least one of the values may be non-canonical.
+ */
+bool
+equalsJsonb(Jsonb *a, Jsonb *b)
+{
+	Size		len = VARSIZE(a);
+
+	if (len == VARSIZE(b) &&
+		((a->root.header ^ b->root.header) & ~JB_FCANONICAL) == 0 &&
+		memcmp(a->root.children, b->root.children,
+			   len - offsetof(Jsonb, root.children)) == 0)
+		return true;
+
+	if (JB_ROOT_IS_CANONICAL(a) && JB_ROOT_IS_CANONICAL(b))
+		return false;
+
+	return compareJsonbContainers(&a->root, &b->root) == 0;
+}
+
+/*
+ * Compute a 64-bit prefix of the B-Tree sort key of a container, for
+ * abbreviated keys: if compareJsonbContainers(a, b) < 0, then the prefix of
+ * a is less than or equal to the prefix of b, compared as unsigned integers.
+ *
+ * From the high bits down, the prefix holds the same things
+ * compareJsonbContainers() looks at first: the container type (1 bit), the
+ * number of children (28 bits) and for arrays whether it is not a raw
+ * scalar (1 bit).  For an array, these are followed by the type of its first
+ * element (3 bits) and a summary of its value (31 bits).  String values are
+ * compared in a collation-aware manner, so they are not summarized.
+ */
+uint64
+getJsonbSortPrefix(JsonbContainer *jc)
+{
+	uint32		count = JsonContainerSize(jc);
+	uint64		prefix;
+	JsonbValue	v;
+	uint64		type;
+	uint64		value = 0;
+
+	prefix = (uint64) (JsonContainerIsObject(jc) ? 1 : 0) << 63;
+	prefix |= (uint64) count << 35;
+
+	if (JsonContainerIsObject(jc))
+		return prefix;
+
+	if (!JsonContainerIsScalar(jc))
+		prefix |= UINT64CONST(1) << 34;
+
+	if (count == 0)
+		return prefix;
+
+	fillJsonbValue(jc, 0, (char *) &jc->children[count], 0, &v);
+
+	switch (v.type)
+	{
+		case jbvNull:
+			type = 0;
+			break;
+		case jbvString:
+			type = 1;
+			break;
+		case jbvNumeric:
+			type = 2;
+			value = (uint64) (numeric_sort_prefix(v.val.numeric) +
+							  NUMERIC_SORT_PREFIX_MAX);
+			break;
+		case jbvBool:
+			type = 3;
+			value = v.val.boolean ? 1 : 0;
+			break;
+		case jbvBinary:
+			type = JsonContainerIsObject(v.val.binary.data) ? 5 : 4;
+			break;
+		default:
+			elog(ERROR, "unknown type of jsonb container");
+			type = 0;			/* keep compiler quiet */
+			break;
 	}
 
-	return res;
+	return prefix | (type << 31) | value;
 }
 
 /*
@@ -1358,6 +1500,15 @@ equalsJsonbScalarValue(JsonbValue *aScalar, JsonbValue *bScalar)
 			case jbvString:
 				return lengthCompareJsonbStringValue(aScalar, bScalar) == 0;
 			case jbvNumeric:
+				{
+					int64		aval;
+					int64		bval;
+
+					/* fast path for small integers */
+					if (numeric_get_int64(aScalar->val.numeric, &aval) &&
+						numeric_get_int64(bScalar->val.numeric, &bval))
+						return aval == bval;
+				}
 				return DatumGetBool(DirectFunctionCall2(numeric_eq,
 														PointerGetDatum(aScalar->val.numeric),
 														PointerGetDatum(bScalar->val.numeric)));
@@ -1394,6 +1545,15 @@ compareJsonbScalarValue(JsonbValue *aScalar, JsonbValue *bScalar)
 								  bScalar->val.string.len,
 								  DEFAULT_COLLATION_OID);
 			case jbvNumeric:
+				{
+					int64		aval;
+					int64		bval;
+
+					/* fast path for small integers */
+					if (numeric_get_int64(aScalar->val.numeric, &aval) &&
+						numeric_get_int64(bScalar->val.numeric, &bval))
+						return aval < bval ? -1 : aval > bval ? 1 : 0;
+				}
 				return DatumGetInt32(DirectFunctionCall2(numeric_cmp,
 														 PointerGetDatum(aScalar->val.numeric),
 														 PointerGetDatum(bScalar->val.numeric)));
@@ -1499,6 +1659,7 @@ convertToJsonb(JsonbValue *val)
 	StringInfoData buffer;
 	JEntry		jentry;
 	Jsonb	   *res;
+	bool		canonical = true;
 
 	/* Should not already have binary representation */
 	Assert(val->type != jbvBinary);
@@ -1509,7 +1670,7 @@ convertToJsonb(JsonbValue *val)
 	/* Make room for the varlena header */
 	reserveFromBuffer(&buffer, VARHDRSZ);
 
-	convertJsonbValue(&buffer, &jentry, val, 0);
+	convertJsonbValue(&buffer, &jentry, val, 0, &canonical);
 
 	/*
 	 * Note: the JEntry of the root is discarded. Therefore the root
@@ -1521,6 +1682,9 @@ convertToJsonb(JsonbValue *val)
 
 	SET_VARSIZE(res, buffer.len);
 
+	if (canonical)
+		res->root.header |= JB_FCANONICAL;
+
 	return res;
 }
 
@@ -1533,10 +1697,13 @@ convertToJsonb(JsonbValue *val)
  * to adjust for that.
  *
  * If the value is an array or an object, this recurses. 'level' is only used
- * for debugging purposes.
+ * for debugging purposes.  *canonical is cleared if the value contains
+ * anything that prevents its encoding from being canonical, see
+ * JB_FCANONICAL.
  */
 static void
-convertJsonbValue(StringInfo buffer, JEntry *header, JsonbValue *val, int level)
+convertJsonbValue(StringInfo buffer, JEntry *header, JsonbValue *val,
+				  int level, bool *canonical)
 {
 	check_stack_depth();
 
@@ -1551,17 +1718,18 @@ convertJsonbValue(StringInfo buffer, JEntry *header, JsonbValue *val, int level)
 	 */
 
 	if (IsAJsonbScalar(val))
-		convertJsonbScalar(buffer, header, val);
+		convertJsonbScalar(buffer, header, val, canonical);
 	else if (val->type == jbvArray)
-		convertJsonbArray(buffer, header, val, level);
+		convertJsonbArray(buffer, header, val, level, canonical);
 	else if (val->type == jbvObject)
-		convertJsonbObject(buffer, header, val, level);
+		convertJsonbObject(buffer, header, val, level, canonical);
 	else
 		elog(ERROR, "unknown type of jsonb container to convert");
 }
 
 static void
-convertJsonbArray(StringInfo buffer, JEntry *pheader, JsonbValue *val, int level)
+convertJsonbArray(StringInfo buffer, JEntry *pheader, JsonbValue *val,
+				  int level, bool *canonical)
 {
 	int			base_offset;
 	int			jentry_offset;
@@ -1604,7 +1772,7 @@ convertJsonbArray(StringInfo buffer, JEntry *pheader, JsonbValue *val, int level
 		 * Convert element, producing a JEntry and appending its
 		 * variable-length data to buffer
 		 */
-		convertJsonbValue(buffer, &meta, elem, level + 1);
+		convertJsonbValue(buffer, &meta, elem, level + 1, canonical);
 
 		len = JBE_OFFLENFLD(meta);
 		totallen += len;
@@ -1645,7 +1813,8 @@ convertJsonbArray(StringInfo buffer, JEntry *pheader, JsonbValue *val, int level
 }
 
 static void
-convertJsonbObject(StringInfo buffer, JEntry *pheader, JsonbValue *val, int level)
+convertJsonbObject(StringInfo buffer, JEntry *pheader, JsonbValue *val,
+				   int level, bool *canonical)
 {
 	int			base_offset;
 	int			jentry_offset;
@@ -1685,7 +1854,7 @@ convertJsonbObject(StringInfo buffer, JEntry *pheader, JsonbValue *val, int leve
 		 * Convert key, producing a JEntry and appending its variable-length
 		 * data to buffer
 		 */
-		convertJsonbScalar(buffer, &meta, &pair->key);
+		convertJsonbScalar(buffer, &meta, &pair->key, canonical);
 
 		len = JBE_OFFLENFLD(meta);
 		totallen += len;
@@ -1720,7 +1889,7 @@ convertJsonbObject(StringInfo buffer, JEntry *pheader, JsonbValue *val, int leve
 		 * Convert value, producing a JEntry and appending its variable-length
 		 * data to buffer
 		 */
-		convertJsonbValue(buffer, &meta, &pair->value, level + 1);
+		convertJsonbValue(buffer, &meta, &pair->value, level + 1, canonical);
 
 		len = JBE_OFFLENFLD(meta);
 		totallen += len;
@@ -1761,7 +1930,8 @@ convertJsonbObject(StringInfo buffer, JEntry *pheader, JsonbValue *val, int leve
 }
 
 static void
-convertJsonbScalar(StringInfo buffer, JEntry *jentry, JsonbValue *scalarVal)
+convertJsonbScalar(StringInfo buffer, JEntry *jentry, JsonbValue *scalarVal,
+				   bool *canonical)
 {
 	int			numlen;
 	short		padlen;
@@ -1785,6 +1955,9 @@ convertJsonbScalar(StringInfo buffer, JEntry *jentry, JsonbValue *scalarVal)
 			appendToBuffer(buffer, (char *) scalarVal->val.numeric, numlen);
 
 			*jentry = JENTRY_ISNUMERIC | (padlen + numlen);
+
+			if (!numeric_is_canonical(scalarVal->val.numeric))
+				*canonical = false;
 			break;
 
 		case jbvBool:
@@ -1813,6 +1986,582 @@ convertJsonbScalar(StringInfo buffer, JEntry *jentry, JsonbValue *scalarVal)
 	}
 }
 
+/*
+ * Start streaming encoding of a Jsonb.
+ */
+JsonbEncodeState *
+startJsonbEncode(bool unique_keys)
+{
+	JsonbEncodeState *state = palloc0(sizeof(JsonbEncodeState));
+
+	initStringInfo(&state->data);
+	initStringInfo(&state->container);
+	state->entriesSize = 16;
+	state->entries = palloc(sizeof(JsonbEncodeEntry) * state->entriesSize);
+	state->levelsSize = 8;
+	state->levels = palloc(sizeof(JsonbEncodeLevel) * state->levelsSize);
+	state->unique_keys = unique_keys;
+
+	return state;
+}
+
+/*
+ * Open a new array or object.
+ */
+void
+encodeJsonbBeginContainer(JsonbEncodeState *state, bool isObject)
+{
+	encodeJsonbPushLevel(state, isObject, false);
+}
+
+/*
+ * Add a key to the innermost open object.  It must be followed by the value.
+ */
+void
+encodeJsonbKey(JsonbEncodeState *state, const char *key, int len)
+{
+	JsonbEncodeLevel *level = &state->levels[state->nlevels - 1];
+	JsonbEncodeEntry *entry;
+
+	Assert(state->nlevels > 0 && level->isObject);
+	Assert((state->nentries - level->firstEntry) % 2 == 0);
+
+	if ((state->nentries - level->firstEntry) / 2 >= JSONB_MAX_PAIRS)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("number of jsonb object pairs exceeds the maximum allowed (%zu)",
+						JSONB_MAX_PAIRS)));
+
+	entry = encodeJsonbNewEntry(state);
+	entry->meta = JENTRY_ISSTRING;
+	entry->align = false;
+	entry->offset = state->data.len;
+	entry->len = len;
+
+	appendToBuffer(&state->data, key, len);
+}
+
+/*
+ * Add a scalar as an element of the innermost open array, or as the value of
+ * the last key of the innermost open object.  A scalar passed outside of any
+ * container becomes the raw scalar root of the result.
+ */
+void
+encodeJsonbScalar(JsonbEncodeState *state, JsonbValue *scalarVal)
+{
+	JsonbEncodeEntry *entry;
+	bool		rawScalar = state->nlevels == 0;
+
+	if (rawScalar)
+		encodeJsonbPushLevel(state, false, true);
+
+	entry = encodeJsonbNewValueEntry(state);
+	entry->align = false;
+	entry->offset = state->data.len;
+	entry->len = 0;
+
+	switch (scalarVal->type)
+	{
+		case jbvNull:
+			entry->meta = JENTRY_ISNULL;
+			break;
+
+		case jbvString:
+			appendToBuffer(&state->data, scalarVal->val.string.val,
+						   scalarVal->val.string.len);
+			entry->meta = JENTRY_ISSTRING;
+			entry->len = scalarVal->val.string.len;
+			break;
+
+		case jbvNumeric:
+			entry->len = VARSIZE_ANY(scalarVal->val.numeric);
+			appendToBuffer(&state->data, (char *) scalarVal->val.numeric,
+						   entry->len);
+			entry->meta = JENTRY_ISNUMERIC;
+			entry->align = true;
+			if (!numeric_is_canonical(scalarVal->val.numeric))
+				state->noncanonical = true;
+			break;
+
+		case jbvBool:
+			entry->meta = (scalarVal->val.boolean) ?
+				JENTRY_ISBOOL_TRUE : JENTRY_ISBOOL_FALSE;
+			break;
+
+		case jbvDatetime:
+			{
+				char		buf[MAXDATELEN + 1];
+
+				JsonEncodeDateTime(buf,
+								   scalarVal->val.datetime.value,
+								   scalarVal->val.datetime.typid,
+								   &scalarVal->val.datetime.tz);
+				entry->len = strlen(buf);
+				appendToBuffer(&state->data, buf, entry->len);
+				entry->meta = JENTRY_ISSTRING;
+			}
+			break;
+
+		default:
+			elog(ERROR, "invalid jsonb scalar type");
+	}
+
+	if (rawScalar)
+		encodeJsonbEndContainer(state);
+}
+
+/*
+ * Close the innermost open array or object.
+ */
+void
+encodeJsonbEndContainer(JsonbEncodeState *state)
+{
+	JsonbEncodeLevel *level = &state->levels[state->nlevels - 1];
+	StringInfo	buffer = &state->container;
+	int			base_offset;
+
+	Assert(state->nlevels > 0);
+
+	resetStringInfo(buffer);
+
+	/* The root container is assembled right in the result varlena */
+	if (state->nlevels == 1)
+		reserveFromBuffer(buffer, VARHDRSZ);
+
+	base_offset = buffer->len;
+
+	encodeJsonbContainer(state, buffer, level);
+
+	/* Pop the children and the level */
+	state->data.len = level->dataStart;
+	state->data.data[state->data.len] = '\0';
+	state->nentries = level->firstEntry;
+	state->nlevels--;
+
+	if (state->nlevels == 0)
+	{
+		/* the container buffer now belongs to the result */
+		state->result = (Jsonb *) buffer->data;
+		SET_VARSIZE(state->result, buffer->len);
+
+		if (!state->noncanonical)
+			state->result->root.header |= JB_FCANONICAL;
+	}
+	else
+	{
+		JsonbEncodeEntry *entry = encodeJsonbNewValueEntry(state);
+
+		entry->meta = JENTRY_ISCONTAINER;
+		entry->align = true;
+		entry->offset = state->data.len;
+		entry->len = buffer->len - base_offset;
+
+		appendToBuffer(&state->data, buffer->data + base_offset, entry->len);
+	}
+}
+
+/*
+ * Finish streaming encoding and return the resulting Jsonb.
+ */
+Jsonb *
+finishJsonbEncode(JsonbEncodeState *state)
+{
+	Jsonb	   *result = state->result;
+
+	Assert(state->nlevels == 0 && result != NULL);
+
+	/* state->container.data is the result, so keep it */
+	pfree(state->data.data);
+	pfree(state->entries);
+	pfree(state->levels);
+	pfree(state);
+
+	return result;
+}
+
+/*
+ * Add an already encoded Jsonb as an element of the innermost open array, or
+ * as the value of the last key of the innermost open object.  Its binary
+ * representation is copied verbatim instead of being decoded and encoded
+ * again.
+ */
+void
+encodeJsonbBinary(JsonbEncodeState *state, Jsonb *jb)
+{
+	JsonbContainer *jc = &jb->root;
+	JsonbEncodeEntry *entry;
+
+	Assert(state->nlevels > 0);
+
+	entry = encodeJsonbNewValueEntry(state);
+	entry->offset = state->data.len;
+
+	/* We don't look inside, so just trust the flag of the source */
+	if (!JB_ROOT_IS_CANONICAL(jb))
+		state->noncanonical = true;
+
+	if (JsonContainerIsScalar(jc))
+	{
+		/*
+		 * Unwrap the raw scalar.  Its data starts the data area right after
+		 * the single JEntry, so a numeric there has no padding.
+		 */
+		entry->meta = jc->children[0] & JENTRY_TYPEMASK;
+		entry->align = JBE_ISNUMERIC(jc->children[0]);
+		entry->len = getJsonbLength(jc, 0);
+
+		appendToBuffer(&state->data, (char *) &jc->children[1], entry->len);
+	}
+	else
+	{
+		uint32		header = jc->header & ~JB_FCANONICAL;
+
+		entry->meta = JENTRY_ISCONTAINER;
+		entry->align = true;
+		entry->len = VARSIZE(jb) - VARHDRSZ;
+
+		/* JB_FCANONICAL is only allowed in the root container */
+		appendToBuffer(&state->data, (char *) &header, sizeof(uint32));
+		appendToBuffer(&state->data, (char *) jc->children,
+					   entry->len - sizeof(uint32));
+	}
+}
+
+/*
+ * Remove the first element of the root array, which must be the only open
+ * container.  The space of removed elements is reclaimed once they take as
+ * many entries as the remaining ones, so that removing elements one by one
+ * from the head while adding them to the tail takes amortized constant time.
+ */
+void
+encodeJsonbRemoveFirst(JsonbEncodeState *state)
+{
+	JsonbEncodeLevel *level = &state->levels[0];
+	int			nremoved;
+	int			nremaining;
+	int			i;
+
+	Assert(state->nlevels == 1 && !level->isObject && !level->rawScalar);
+	Assert(level->firstEntry < state->nentries);
+
+	level->firstEntry++;
+	level->dataStart = level->firstEntry < state->nentries ?
+		state->entries[level->firstEntry].offset : state->data.len;
+
+	nremoved = level->firstEntry;
+	nremaining = state->nentries - nremoved;
+
+	if (nremoved < nremaining)
+		return;
+
+	/* Move the remaining elements and their data to the start of buffers */
+	memmove(state->entries, &state->entries[nremoved],
+			sizeof(JsonbEncodeEntry) * nremaining);
+
+	for (i = 0; i < nremaining; i++)
+		state->entries[i].offset -= level->dataStart;
+
+	state->data.len -= level->dataStart;
+	memmove(state->data.data, state->data.data + level->dataStart,
+			state->data.len + 1);
+
+	state->nentries = nremaining;
+	level->firstEntry = 0;
+	level->dataStart = 0;
+}
+
+/*
+ * Return the Jsonb that would result from closing the root container now,
+ * while leaving it open, so that more children can be added afterwards.
+ */
+Jsonb *
+peekJsonbEncode(JsonbEncodeState *state)
+{
+	StringInfoData buffer;
+	Jsonb	   *result;
+
+	Assert(state->nlevels == 1);
+
+	initStringInfo(&buffer);
+	reserveFromBuffer(&buffer, VARHDRSZ);
+
+	encodeJsonbContainer(state, &buffer, &state->levels[0]);
+
+	result = (Jsonb *) buffer.data;
+	SET_VARSIZE(result, buffer.len);
+
+	if (!state->noncanonical)
+		result->root.header |= JB_FCANONICAL;
+
+	return result;
+}
+
+static void
+encodeJsonbPushLevel(JsonbEncodeState *state, bool isObject, bool rawScalar)
+{
+	JsonbEncodeLevel *level;
+
+	if (state->nlevels >= state->levelsSize)
+	{
+		state->levelsSize *= 2;
+		state->levels = repalloc(state->levels,
+								 sizeof(JsonbEncodeLevel) * state->levelsSize);
+	}
+
+	level = &state->levels[state->nlevels++];
+	level->isObject = isObject;
+	level->rawScalar = rawScalar;
+	level->firstEntry = state->nentries;
+	level->dataStart = state->data.len;
+}
+
+static JsonbEncodeEntry *
+encodeJsonbNewEntry(JsonbEncodeState *state)
+{
+	if (state->nentries >= state->entriesSize)
+	{
+		state->entriesSize *= 2;
+		state->entries = repalloc_huge(state->entries,
+									   sizeof(JsonbEncodeEntry) *
+									   state->entriesSize);
+	}
+
+	return &state->entries[state->nentries++];
+}
+
+/*
+ * Allocate the entry for an array element or an object value.
+ */
+static JsonbEncodeEntry *
+encodeJsonbNewValueEntry(JsonbEncodeState *state)
+{
+	JsonbEncodeLevel *level = &state->levels[state->nlevels - 1];
+
+	if (level->isObject)
+		Assert((state->nentries - level->firstEntry) % 2 == 1);
+	else if (state->nentries - level->firstEntry >= JSONB_MAX_ELEMS)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("number of jsonb array elements exceeds the maximum allowed (%zu)",
+						JSONB_MAX_ELEMS)));
+
+	return encodeJsonbNewEntry(state);
+}
+
+/*
+ * Append data of the encoded child to the container being assembled,
+ * returning its JEntry.
+ */
+static JEntry
+encodeJsonbChild(JsonbEncodeState *state, StringInfo buffer,
+				 JsonbEncodeEntry *child)
+{
+	short		padlen = child->align ? padBufferToInt(buffer) : 0;
+
+	appendToBuffer(buffer, state->data.data + child->offset, child->len);
+
+	return child->meta | (padlen + child->len);
+}
+
+/*
+ * Assemble the open container from its encoded children into the buffer.
+ * The state is not modified.
+ */
+static void
+encodeJsonbContainer(JsonbEncodeState *state, StringInfo buffer,
+					 JsonbEncodeLevel *level)
+{
+	JsonbEncodeEntry *children = &state->entries[level->firstEntry];
+	int			nchildren = state->nentries - level->firstEntry;
+
+	if (level->isObject)
+		encodeJsonbObject(state, buffer, children, nchildren / 2);
+	else
+		encodeJsonbArray(state, buffer, children, nchildren, level->rawScalar);
+}
+
+/*
+ * Assemble an array from its encoded elements, see convertJsonbArray().
+ */
+static void
+encodeJsonbArray(JsonbEncodeState *state, StringInfo buffer,
+				 JsonbEncodeEntry *elems, int nElems, bool rawScalar)
+{
+	int			base_offset = buffer->len;
+	int			jentry_offset;
+	int			i;
+	int			totallen;
+	uint32		header;
+
+	Assert(INTALIGN(buffer->len) == buffer->len);
+
+	header = nElems | JB_FARRAY;
+	if (rawScalar)
+	{
+		Assert(nElems == 1);
+		header |= JB_FSCALAR;
+	}
+
+	appendToBuffer(buffer, (char *) &header, sizeof(uint32));
+
+	/* Reserve space for the JEntries of the elements. */
+	jentry_offset = reserveFromBuffer(buffer, sizeof(JEntry) * nElems);
+
+	totallen = 0;
+	for (i = 0; i < nElems; i++)
+	{
+		JEntry		meta = encodeJsonbChild(state, buffer, &elems[i]);
+
+		totallen += JBE_OFFLENFLD(meta);
+
+		if (totallen > JENTRY_OFFLENMASK)
+			ereport(ERROR,
+					(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+					 errmsg("total size of jsonb array elements exceeds the maximum of %u bytes",
+							JENTRY_OFFLENMASK)));
+
+		if ((i % JB_OFFSET_STRIDE) == 0)
+			meta = (meta & JENTRY_TYPEMASK) | totallen | JENTRY_HAS_OFF;
+
+		copyToBuffer(buffer, jentry_offset, (char *) &meta, sizeof(JEntry));
+		jentry_offset += sizeof(JEntry);
+	}
+
+	if (buffer->len - base_offset > JENTRY_OFFLENMASK)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("total size of jsonb array elements exceeds the maximum of %u bytes",
+						JENTRY_OFFLENMASK)));
+}
+
+/*
+ * Assemble an object from its encoded key/value pairs, see
+ * convertJsonbObject() and uniqueifyJsonbObject().
+ */
+static void
+encodeJsonbObject(JsonbEncodeState *state, StringInfo buffer,
+				  JsonbEncodeEntry *pairs, int nPairs)
+{
+	int			base_offset = buffer->len;
+	int			jentry_offset;
+	int		   *order;
+	int			i;
+	int			totallen;
+	uint32		header;
+
+	Assert(INTALIGN(buffer->len) == buffer->len);
+
+	/* Sort pairs by keys, and remove duplicates keeping the last ones */
+	order = palloc(sizeof(int) * Max(nPairs, 1));
+
+	for (i = 0; i < nPairs; i++)
+		order[i] = i;
+
+	if (nPairs > 1)
+	{
+		JsonbEncodePairsCompareArg arg;
+
+		arg.state = state;
+		arg.pairs = pairs;
+		arg.hasNonUniq = false;
+
+		qsort_arg(order, nPairs, sizeof(int), lengthCompareJsonbEncodePair,
+				  &arg);
+
+		if (arg.hasNonUniq)
+		{
+			int			nunique = 1;
+
+			if (state->unique_keys)
+				ereport(ERROR,
+						(errcode(ERRCODE_DUPLICATE_JSON_OBJECT_KEY_VALUE),
+						 errmsg("duplicate JSON object key value")));
+
+			for (i = 1; i < nPairs; i++)
+			{
+				JsonbEncodeEntry *key = &pairs[order[i] * 2];
+				JsonbEncodeEntry *prev = &pairs[order[nunique - 1] * 2];
+
+				if (lengthCompareJsonbString(state->data.data + key->offset,
+											 key->len,
+											 state->data.data + prev->offset,
+											 prev->len) != 0)
+					order[nunique++] = order[i];
+			}
+
+			nPairs = nunique;
+		}
+	}
+
+	header = nPairs | JB_FOBJECT;
+	appendToBuffer(buffer, (char *) &header, sizeof(uint32));
+
+	/* Reserve space for the JEntries of the keys and values. */
+	jentry_offset = reserveFromBuffer(buffer, sizeof(JEntry) * nPairs * 2);
+
+	/*
+	 * Iterate over the keys, then over the values, since that is the ordering
+	 * we want in the on-disk representation.
+	 */
+	totallen = 0;
+	for (i = 0; i < nPairs * 2; i++)
+	{
+		int			pair = order[i % nPairs];
+		JEntry		meta = encodeJsonbChild(state, buffer,
+											&pairs[pair * 2 + i / nPairs]);
+
+		totallen += JBE_OFFLENFLD(meta);
+
+		if (totallen > JENTRY_OFFLENMASK)
+			ereport(ERROR,
+					(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+					 errmsg("total size of jsonb object elements exceeds the maximum of %u bytes",
+							JENTRY_OFFLENMASK)));
+
+		if ((i % JB_OFFSET_STRIDE) == 0)
+			meta = (meta & JENTRY_TYPEMASK) | totallen | JENTRY_HAS_OFF;
+
+		copyToBuffer(buffer, jentry_offset, (char *) &meta, sizeof(JEntry));
+		jentry_offset += sizeof(JEntry);
+	}
+
+	pfree(order);
+
+	if (buffer->len - base_offset > JENTRY_OFFLENMASK)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("total size of jsonb object elements exceeds the maximum of %u bytes",
+						JENTRY_OFFLENMASK)));
+}
+
+/*
+ * qsort_arg() comparator to order indexes of encoded key/value pairs by
+ * their keys.  Pairs with equal keys are ordered so that the last observed
+ * one goes first, like in lengthCompareJsonbPair().
+ */
+static int
+lengthCompareJsonbEncodePair(const void *a, const void *b, void *arg)
+{
+	JsonbEncodePairsCompareArg *cmparg = (JsonbEncodePairsCompareArg *) arg;
+	int			ia = *(const int *) a;
+	int			ib = *(const int *) b;
+	JsonbEncodeEntry *ka = &cmparg->pairs[ia * 2];
+	JsonbEncodeEntry *kb = &cmparg->pairs[ib * 2];
+	char	   *data = cmparg->state->data.data;
+	int			res;
+
+	res = lengthCompareJsonbString(data + ka->offset, ka->len,
+								   data + kb->offset, kb->len);
+
+	if (res == 0 && ia != ib)
+	{
+		cmparg->hasNonUniq = true;
+		res = (ia > ib) ? -1 : 1;
+	}
+
+	return res;
+}
+
 /*
  * Compare two jbvString JsonbValue values, a and b.
  *
@@ -24,14 +24,20 @@
 #include "lib/stringinfo.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "nodes/supportnodes.h"
+#include "optimizer/optimizer.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/catcache.h"
 #include "utils/hsearch.h"
+#include "utils/inval.h"
 #include "utils/json.h"
 #include "utils/jsonb.h"
 #include "utils/jsonfuncs.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/numeric.h"
 #include "utils/syscache.h"
 #include "utils/typcache.h"
 
@@ -89,6 +95,8 @@ typedef struct GetState
 	bool	   *pathok;			/* is path matched to current depth? */
 	int		   *array_cur_index;	/* current element index at each path
 									 * level */
+	bool		can_stop;		/* may we stop parsing after a match? */
+	char	   *recheck_after;	/* path can match again before this point */
 } GetState;
 
 /* state for json_array_length */
@@ -223,6 +231,8 @@ struct RecordIOData
 	Oid			record_type;
 	int32		record_typmod;
 	int			ncolumns;
+	int		   *sorted_columns; /* non-dropped columns in jsonb key order */
+	int			nsorted_columns;
 	ColumnIOData columns[FLEXIBLE_ARRAY_MEMBER];
 };
 
@@ -346,6 +356,8 @@ static void get_array_end(void *state);
 static void get_array_element_start(void *state, bool isnull);
 static void get_array_element_end(void *state, bool isnull);
 static void get_scalar(void *state, char *token, JsonTokenType tokentype);
+static void get_check_stop(GetState *state, int lex_level);
+static char *find_quoted_name(char *start, char *end, const char *name);
 
 /* common worker function for json getter functions */
 static Datum get_path_all(FunctionCallInfo fcinfo, bool as_text);
@@ -361,6 +373,10 @@ static void alen_array_element_start(void *state, bool isnull);
 
 /* common workers for json{b}_each* functions */
 static Datum each_worker(FunctionCallInfo fcinfo, bool as_text);
+static Jsonb *jsonb_srf_init(FunctionCallInfo fcinfo,
+							 FuncCallContext *funcctx);
+static JsonbIteratorToken jsonb_srf_next(FuncCallContext *funcctx,
+										 JsonbValue *v);
 static Datum each_worker_jsonb(FunctionCallInfo fcinfo, const char *funcname,
 							   bool as_text);
 
@@ -519,31 +535,124 @@ makeJsonLexContext(text *json, bool need_escapes)
 }
 
 /*
- * SQL function json_object_keys
+ * Start value-per-call iteration over the root container of a jsonb passed
+ * as the first argument of an SRF.
+ *
+ * The argument is detoasted in the multi-call context, so that it lives as
+ * long as the iterator over it (if no detoast happens, we assume that the
+ * originally passed datum will stick around till then, as array_unnest()
+ * does).
+ *
+ * Rows are only produced as they are consumed when the SRF is called in the
+ * target list (ProjectSet), e.g. "SELECT jsonb_each(js) ... LIMIT 1".  In
+ * FROM, ExecMakeTableFunctionResult() still reads every row into a
+ * tuplestore before the first one is returned, so the whole container is
+ * expanded there even if only a few rows are used.
+ */
+static Jsonb *
+jsonb_srf_init(FunctionCallInfo fcinfo, FuncCallContext *funcctx)
+{
+	MemoryContext oldcontext;
+	Jsonb	   *jb;
+
+	oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+	jb = PG_GETARG_JSONB_P(0);
+	funcctx->user_fctx = JsonbIteratorInit(&jb->root);
+	MemoryContextSwitchTo(oldcontext);
+
+	return jb;
+}
+
+/*
+ * Fetch the next key, value or element of the root container iterated by
+ * a value-per-call SRF, returning WJB_DONE at the end.  Nested containers
+ * are returned as jbvBinary values pointing into the jsonb.
+ */
+static JsonbIteratorToken
+jsonb_srf_next(FuncCallContext *funcctx, JsonbValue *v)
+{
+	JsonbIterator *it = (JsonbIterator *) funcctx->user_fctx;
+	MemoryContext oldcontext;
+	JsonbIteratorToken r;
+
+	oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+	do
+	{
+		r = JsonbIteratorNext(&it, v, true);
+	} while (r == WJB_BEGIN_OBJECT || r == WJB_END_OBJECT ||
+			 r == WJB_BEGIN_ARRAY || r == WJB_END_ARRAY);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	funcctx->user_fctx = it;
+
+	return r;
+}
+
+/*
+ * Planner support function for the jsonb SRFs iterating over the root
+ * container of their argument.
+ */
+Datum
+jsonb_srf_support(PG_FUNCTION_ARGS)
+{
+	Node	   *rawreq = (Node *) PG_GETARG_POINTER(0);
+	Node	   *ret = NULL;
+
+	if (IsA(rawreq, SupportRequestRows))
+	{
+		/* Try to estimate the number of rows returned */
+		SupportRequestRows *req = (SupportRequestRows *) rawreq;
+
+		if (is_funcclause(req->node))	/* be paranoid */
+		{
+			List	   *args = ((FuncExpr *) req->node)->args;
+			Node	   *arg;
+
+			/* We can use estimated argument values here */
+			arg = estimate_expression_value(req->root, linitial(args));
+
+			/*
+			 * The functions are strict, so a constant NULL returns no rows.
+			 * Otherwise, for a constant the number of rows is the size of
+			 * its root container.
+			 */
+			if (IsA(arg, Const))
+			{
+				Const	   *c = (Const *) arg;
+
+				req->rows = c->constisnull ? 0 :
+					JB_ROOT_COUNT(DatumGetJsonbP(c->constvalue));
+				ret = (Node *) req;
+			}
+		}
+	}
+
+	PG_RETURN_POINTER(ret);
+}
+
+/*
+ * SQL function jsonb_object_keys
  *
  * Returns the set of keys for the object argument.
  *
- * This SRF operates in value-per-call mode. It processes the
- * object during the first call, and the keys are simply stashed
- * in an array, whose size is expanded as necessary. This is probably
- * safe enough for a list of keys of a single object, since they are
- * limited in size to NAMEDATALEN and the number of keys is unlikely to
- * be so huge that it has major memory implications.
+ * This SRF operates in value-per-call mode, iterating over the object
+ * lazily.
  */
 Datum
 jsonb_object_keys(PG_FUNCTION_ARGS)
 {
 	FuncCallContext *funcctx;
-	OkeysState *state;
+	JsonbValue	v;
+	JsonbIteratorToken r;
 
 	if (SRF_IS_FIRSTCALL())
 	{
-		MemoryContext oldcontext;
-		Jsonb	   *jb = PG_GETARG_JSONB_P(0);
-		bool		skipNested = false;
-		JsonbIterator *it;
-		JsonbValue	v;
-		JsonbIteratorToken r;
+		Jsonb	   *jb;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		jb = jsonb_srf_init(fcinfo, funcctx);
 
 		if (JB_ROOT_IS_SCALAR(jb))
 			ereport(ERROR,
@@ -555,46 +664,17 @@ jsonb_object_keys(PG_FUNCTION_ARGS)
 					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 					 errmsg("cannot call %s on an array",
 							"jsonb_object_keys")));
-
-		funcctx = SRF_FIRSTCALL_INIT();
-		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
-
-		state = palloc(sizeof(OkeysState));
-
-		state->result_size = JB_ROOT_COUNT(jb);
-		state->result_count = 0;
-		state->sent_count = 0;
-		state->result = palloc(state->result_size * sizeof(char *));
-
-		it = JsonbIteratorInit(&jb->root);
-
-		while ((r = JsonbIteratorNext(&it, &v, skipNested)) != WJB_DONE)
-		{
-			skipNested = true;
-
-			if (r == WJB_KEY)
-			{
-				char	   *cstr;
-
-				cstr = palloc(v.val.string.len + 1 * sizeof(char));
-				memcpy(cstr, v.val.string.val, v.val.string.len);
-				cstr[v.val.string.len] = '\0';
-				state->result[state->result_count++] = cstr;
-			}
-		}
-
-		MemoryContextSwitchTo(oldcontext);
-		funcctx->user_fctx = (void *) state;
 	}
 
 	funcctx = SRF_PERCALL_SETUP();
-	state = (OkeysState *) funcctx->user_fctx;
 
-	if (state->sent_count < state->result_count)
+	/* skip the values */
+	while ((r = jsonb_srf_next(funcctx, &v)) != WJB_DONE)
 	{
-		char	   *nxt = state->result[state->sent_count++];
-
-		SRF_RETURN_NEXT(funcctx, CStringGetTextDatum(nxt));
+		if (r == WJB_KEY)
+			SRF_RETURN_NEXT(funcctx,
+							PointerGetDatum(cstring_to_text_with_len(v.val.string.val,
+																	 v.val.string.len)));
 	}
 
 	SRF_RETURN_DONE(funcctx);
@@ -1087,6 +1167,9 @@ get_worker(text *json,
 	if (npath > 0)
 		state->pathok[0] = true;
 
+	/* the json is known to be valid, so we can skip the rest after a match */
+	state->can_stop = true;
+
 	sem->semstate = (void *) state;
 
 	/*
@@ -1200,6 +1283,7 @@ static void
 get_object_field_end(void *state, char *fname, bool isnull)
 {
 	GetState   *_state = (GetState *) state;
+	bool		matched = false;
 	bool		get_last = false;
 	int			lex_level = _state->lex->lex_level;
 
@@ -1210,6 +1294,8 @@ get_object_field_end(void *state, char *fname, bool isnull)
 		_state->path_names[lex_level - 1] != NULL &&
 		strcmp(fname, _state->path_names[lex_level - 1]) == 0)
 	{
+		matched = true;
+
 		if (lex_level < _state->npath)
 		{
 			/* done with this field so reset pathok */
@@ -1243,6 +1329,9 @@ get_object_field_end(void *state, char *fname, bool isnull)
 		/* this should be unnecessary but let's do it for cleanliness: */
 		_state->result_start = NULL;
 	}
+
+	if (matched)
+		get_check_stop(_state, lex_level);
 }
 
 static void
@@ -1349,6 +1438,7 @@ static void
 get_array_element_end(void *state, bool isnull)
 {
 	GetState   *_state = (GetState *) state;
+	bool		matched = false;
 	bool		get_last = false;
 	int			lex_level = _state->lex->lex_level;
 
@@ -1358,6 +1448,8 @@ get_array_element_end(void *state, bool isnull)
 		_state->path_indexes != NULL &&
 		_state->array_cur_index[lex_level - 1] == _state->path_indexes[lex_level - 1])
 	{
+		matched = true;
+
 		if (lex_level < _state->npath)
 		{
 			/* done with this element so reset pathok */
@@ -1385,6 +1477,9 @@ get_array_element_end(void *state, bool isnull)
 
 		_state->result_start = NULL;
 	}
+
+	if (matched)
+		get_check_stop(_state, lex_level);
 }
 
 static void
@@ -1428,6 +1523,79 @@ get_scalar(void *state, char *token, JsonTokenType tokentype)
 	}
 }
 
+/*
+ * Called at the end of a value matching the path being sought up to nesting
+ * level lex_level.  If nothing in the rest of the input can match the path
+ * again, the result is final, so tell the parser to skip the rest.
+ *
+ * Array elements at these levels can't match again, since their indexes are
+ * unique.  Object fields can, because of duplicate keys, and then the last
+ * one wins.  As long as the rest of the input has no escapes, such a key must
+ * be spelled literally, so a plain search for each quoted name is enough.
+ * Requiring no escapes also means that we don't skip any strings which
+ * would fail to de-escape; everything else was checked by json_in().
+ */
+static void
+get_check_stop(GetState *state, int lex_level)
+{
+	JsonLexContext *lex = state->lex;
+	char	   *rest = lex->prev_token_terminator;
+	char	   *end = lex->input + lex->input_length;
+	int			i;
+
+	if (!state->can_stop ||
+		(state->recheck_after != NULL && rest <= state->recheck_after))
+		return;
+
+	if (memchr(rest, '\\', end - rest) != NULL)
+	{
+		state->can_stop = false;
+		return;
+	}
+
+	for (i = 0; state->path_names != NULL && i < lex_level; i++)
+	{
+		char	   *name;
+
+		if (state->path_names[i] == NULL)
+			continue;
+
+		name = find_quoted_name(rest, end, state->path_names[i]);
+		if (name != NULL)
+		{
+			/* no point in searching again until we get past this one */
+			state->recheck_after = name;
+			return;
+		}
+	}
+
+	lex->stop_parsing = true;
+}
+
+/*
+ * Find the first occurrence of string "name" in double quotes between start
+ * and end.
+ */
+static char *
+find_quoted_name(char *start, char *end, const char *name)
+{
+	int			len = strlen(name);
+	char	   *p;
+
+	for (p = start; end - p >= len + 2; p++)
+	{
+		p = memchr(p, '"', end - p - len - 1);
+
+		if (p == NULL)
+			break;
+
+		if (p[len + 1] == '"' && memcmp(p + 1, name, len) == 0)
+			return p;
+	}
+
+	return NULL;
+}
+
 Datum
 jsonb_extract_path(PG_FUNCTION_ARGS)
 {
@@ -1616,6 +1784,15 @@ JsonbValueAsText(JsonbValue *v)
 		case jbvNumeric:
 			{
 				Datum		cstr;
+				int64		val;
+
+				/* print small integers without going through numeric_out */
+				if (numeric_get_int64(v->val.numeric, &val))
+				{
+					char		buf[MAXINT8LEN + 1];
+
+					return cstring_to_text_with_len(buf, pg_lltoa(val, buf));
+				}
 
 				cstr = DirectFunctionCall1(numeric_out,
 										   PointerGetDatum(v->val.numeric));
@@ -1764,121 +1941,85 @@ jsonb_each_text(PG_FUNCTION_ARGS)
 static Datum
 each_worker_jsonb(FunctionCallInfo fcinfo, const char *funcname, bool as_text)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
-	ReturnSetInfo *rsi;
-	Tuplestorestate *tuple_store;
-	TupleDesc	tupdesc;
-	TupleDesc	ret_tdesc;
-	MemoryContext old_cxt,
-				tmp_cxt;
-	bool		skipNested = false;
-	JsonbIterator *it;
+	FuncCallContext *funcctx;
 	JsonbValue	v;
-	JsonbIteratorToken r;
-
-	if (!JB_ROOT_IS_OBJECT(jb))
-		ereport(ERROR,
-				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-				 errmsg("cannot call %s on a non-object",
-						funcname)));
 
-	rsi = (ReturnSetInfo *) fcinfo->resultinfo;
-
-	if (!rsi || !IsA(rsi, ReturnSetInfo) ||
-		(rsi->allowedModes & SFRM_Materialize) == 0 ||
-		rsi->expectedDesc == NULL)
-		ereport(ERROR,
-				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-				 errmsg("set-valued function called in context that "
-						"cannot accept a set")));
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		TupleDesc	tupdesc;
+		Jsonb	   *jb;
 
-	rsi->returnMode = SFRM_Materialize;
+		funcctx = SRF_FIRSTCALL_INIT();
+		jb = jsonb_srf_init(fcinfo, funcctx);
 
-	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
-		ereport(ERROR,
-				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-				 errmsg("function returning record called in context "
-						"that cannot accept type record")));
+		if (!JB_ROOT_IS_OBJECT(jb))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("cannot call %s on a non-object",
+							funcname)));
 
-	old_cxt = MemoryContextSwitchTo(rsi->econtext->ecxt_per_query_memory);
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
 
-	ret_tdesc = CreateTupleDescCopy(tupdesc);
-	BlessTupleDesc(ret_tdesc);
-	tuple_store =
-		tuplestore_begin_heap(rsi->allowedModes & SFRM_Materialize_Random,
-							  false, work_mem);
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("function returning record called in context "
+							"that cannot accept type record")));
 
-	MemoryContextSwitchTo(old_cxt);
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
 
-	tmp_cxt = AllocSetContextCreate(CurrentMemoryContext,
-									"jsonb_each temporary cxt",
-									ALLOCSET_DEFAULT_SIZES);
+		MemoryContextSwitchTo(oldcontext);
+	}
 
-	it = JsonbIteratorInit(&jb->root);
+	funcctx = SRF_PERCALL_SETUP();
 
-	while ((r = JsonbIteratorNext(&it, &v, skipNested)) != WJB_DONE)
+	if (jsonb_srf_next(funcctx, &v) == WJB_KEY)
 	{
-		skipNested = true;
-
-		if (r == WJB_KEY)
-		{
-			text	   *key;
-			HeapTuple	tuple;
-			Datum		values[2];
-			bool		nulls[2] = {false, false};
+		text	   *key;
+		HeapTuple	tuple;
+		Datum		values[2];
+		bool		nulls[2] = {false, false};
+		JsonbIteratorToken r PG_USED_FOR_ASSERTS_ONLY;
 
-			/* Use the tmp context so we can clean up after each tuple is done */
-			old_cxt = MemoryContextSwitchTo(tmp_cxt);
+		key = cstring_to_text_with_len(v.val.string.val, v.val.string.len);
 
-			key = cstring_to_text_with_len(v.val.string.val, v.val.string.len);
-
-			/*
-			 * The next thing the iterator fetches should be the value, no
-			 * matter what shape it is.
-			 */
-			r = JsonbIteratorNext(&it, &v, skipNested);
-			Assert(r != WJB_DONE);
+		/*
+		 * The next thing the iterator fetches should be the value, no matter
+		 * what shape it is.
+		 */
+		r = jsonb_srf_next(funcctx, &v);
+		Assert(r == WJB_VALUE);
 
-			values[0] = PointerGetDatum(key);
+		values[0] = PointerGetDatum(key);
 
-			if (as_text)
+		if (as_text)
+		{
+			if (v.type == jbvNull)
 			{
-				if (v.type == jbvNull)
-				{
-					/* a json null is an sql null in text mode */
-					nulls[1] = true;
-					values[1] = (Datum) NULL;
-				}
-				else
-					values[1] = PointerGetDatum(JsonbValueAsText(&v));
+				/* a json null is an sql null in text mode */
+				nulls[1] = true;
+				values[1] = (Datum) NULL;
 			}
 			else
-			{
-				/* Not in text mode, just return the Jsonb */
-				Jsonb	   *val = JsonbValueToJsonb(&v);
-
-				values[1] = PointerGetDatum(val);
-			}
-
-			tuple = heap_form_tuple(ret_tdesc, values, nulls);
-
-			tuplestore_puttuple(tuple_store, tuple);
+				values[1] = PointerGetDatum(JsonbValueAsText(&v));
+		}
+		else
+		{
+			/* Not in text mode, just return the Jsonb */
+			Jsonb	   *val = JsonbValueToJsonb(&v);
 
-			/* clean up and switch back */
-			MemoryContextSwitchTo(old_cxt);
-			MemoryContextReset(tmp_cxt);
+			values[1] = PointerGetDatum(val);
 		}
-	}
 
-	MemoryContextDelete(tmp_cxt);
+		tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
 
-	rsi->setResult = tuple_store;
-	rsi->setDesc = ret_tdesc;
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
 
-	PG_RETURN_NULL();
+	SRF_RETURN_DONE(funcctx);
 }
 
-
 static Datum
 each_worker(FunctionCallInfo fcinfo, bool as_text)
 {
@@ -2061,106 +2202,45 @@ static Datum
 elements_worker_jsonb(FunctionCallInfo fcinfo, const char *funcname,
 					  bool as_text)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
-	ReturnSetInfo *rsi;
-	Tuplestorestate *tuple_store;
-	TupleDesc	tupdesc;
-	TupleDesc	ret_tdesc;
-	MemoryContext old_cxt,
-				tmp_cxt;
-	bool		skipNested = false;
-	JsonbIterator *it;
+	FuncCallContext *funcctx;
 	JsonbValue	v;
-	JsonbIteratorToken r;
 
-	if (JB_ROOT_IS_SCALAR(jb))
-		ereport(ERROR,
-				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-				 errmsg("cannot extract elements from a scalar")));
-	else if (!JB_ROOT_IS_ARRAY(jb))
-		ereport(ERROR,
-				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-				 errmsg("cannot extract elements from an object")));
-
-	rsi = (ReturnSetInfo *) fcinfo->resultinfo;
-
-	if (!rsi || !IsA(rsi, ReturnSetInfo) ||
-		(rsi->allowedModes & SFRM_Materialize) == 0 ||
-		rsi->expectedDesc == NULL)
-		ereport(ERROR,
-				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-				 errmsg("set-valued function called in context that "
-						"cannot accept a set")));
-
-	rsi->returnMode = SFRM_Materialize;
-
-	/* it's a simple type, so don't use get_call_result_type() */
-	tupdesc = rsi->expectedDesc;
-
-	old_cxt = MemoryContextSwitchTo(rsi->econtext->ecxt_per_query_memory);
-
-	ret_tdesc = CreateTupleDescCopy(tupdesc);
-	BlessTupleDesc(ret_tdesc);
-	tuple_store =
-		tuplestore_begin_heap(rsi->allowedModes & SFRM_Materialize_Random,
-							  false, work_mem);
+	if (SRF_IS_FIRSTCALL())
+	{
+		Jsonb	   *jb;
 
-	MemoryContextSwitchTo(old_cxt);
+		funcctx = SRF_FIRSTCALL_INIT();
+		jb = jsonb_srf_init(fcinfo, funcctx);
 
-	tmp_cxt = AllocSetContextCreate(CurrentMemoryContext,
-									"jsonb_array_elements temporary cxt",
-									ALLOCSET_DEFAULT_SIZES);
+		if (JB_ROOT_IS_SCALAR(jb))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("cannot extract elements from a scalar")));
+		else if (!JB_ROOT_IS_ARRAY(jb))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("cannot extract elements from an object")));
+	}
 
-	it = JsonbIteratorInit(&jb->root);
+	funcctx = SRF_PERCALL_SETUP();
 
-	while ((r = JsonbIteratorNext(&it, &v, skipNested)) != WJB_DONE)
+	if (jsonb_srf_next(funcctx, &v) == WJB_ELEM)
 	{
-		skipNested = true;
-
-		if (r == WJB_ELEM)
+		if (!as_text)
 		{
-			HeapTuple	tuple;
-			Datum		values[1];
-			bool		nulls[1] = {false};
-
-			/* use the tmp context so we can clean up after each tuple is done */
-			old_cxt = MemoryContextSwitchTo(tmp_cxt);
-
-			if (as_text)
-			{
-				if (v.type == jbvNull)
-				{
-					/* a json null is an sql null in text mode */
-					nulls[0] = true;
-					values[0] = (Datum) NULL;
-				}
-				else
-					values[0] = PointerGetDatum(JsonbValueAsText(&v));
-			}
-			else
-			{
-				/* Not in text mode, just return the Jsonb */
-				Jsonb	   *val = JsonbValueToJsonb(&v);
-
-				values[0] = PointerGetDatum(val);
-			}
-
-			tuple = heap_form_tuple(ret_tdesc, values, nulls);
-
-			tuplestore_puttuple(tuple_store, tuple);
-
-			/* clean up and switch back */
-			MemoryContextSwitchTo(old_cxt);
-			MemoryContextReset(tmp_cxt);
+			/* Not in text mode, just return the Jsonb */
+			SRF_RETURN_NEXT(funcctx, PointerGetDatum(JsonbValueToJsonb(&v)));
 		}
+		else if (v.type == jbvNull)
+		{
+			/* a json null is an sql null in text mode */
+			SRF_RETURN_NEXT_NULL(funcctx);
+		}
+		else
+			SRF_RETURN_NEXT(funcctx, PointerGetDatum(JsonbValueAsText(&v)));
 	}
 
-	MemoryContextDelete(tmp_cxt);
-
-	rsi->setResult = tuple_store;
-	rsi->setDesc = ret_tdesc;
-
-	PG_RETURN_NULL();
+	SRF_RETURN_DONE(funcctx);
 }
 
 Datum
@@ -2843,6 +2923,70 @@ populate_composite(CompositeIOData *io,
 	return result;
 }
 
+/*
+ * Convert a jsonb scalar to some common types without a round trip through
+ * the text representation.  Returns false if the conversion is not handled
+ * here, including the cases where the input function would raise an error,
+ * so that the caller produces the same error.
+ */
+static bool
+populate_scalar_jsonb_binary(Oid typid, int32 typmod, JsonbValue *jbv,
+							 Datum *res)
+{
+	int64		val;
+
+	switch (typid)
+	{
+		case BOOLOID:
+			if (jbv->type != jbvBool)
+				return false;
+			*res = BoolGetDatum(jbv->val.boolean);
+			return true;
+
+		case INT2OID:
+			if (jbv->type != jbvNumeric ||
+				!numeric_get_int64(jbv->val.numeric, &val) ||
+				val < PG_INT16_MIN || val > PG_INT16_MAX)
+				return false;
+			*res = Int16GetDatum((int16) val);
+			return true;
+
+		case INT4OID:
+			if (jbv->type != jbvNumeric ||
+				!numeric_get_int64(jbv->val.numeric, &val) ||
+				val < PG_INT32_MIN || val > PG_INT32_MAX)
+				return false;
+			*res = Int32GetDatum((int32) val);
+			return true;
+
+		case INT8OID:
+			if (jbv->type != jbvNumeric ||
+				!numeric_get_int64(jbv->val.numeric, &val))
+				return false;
+			*res = Int64GetDatum(val);
+			return true;
+
+		case NUMERICOID:
+			if (jbv->type != jbvNumeric)
+				return false;
+			/* numeric() copies the value, applying the typmod if any */
+			*res = DirectFunctionCall2(numeric,
+									   NumericGetDatum(jbv->val.numeric),
+									   Int32GetDatum(typmod));
+			return true;
+
+		case TEXTOID:
+			if (jbv->type != jbvString)
+				return false;
+			*res = PointerGetDatum(cstring_to_text_with_len(jbv->val.string.val,
+															jbv->val.string.len));
+			return true;
+
+		default:
+			return false;
+	}
+}
+
 /* populate non-null scalar value from json/jsonb value */
 static Datum
 populate_scalar(ScalarIOData *io, Oid typid, int32 typmod, JsValue *jsv)
@@ -2891,6 +3035,9 @@ populate_scalar(ScalarIOData *io, Oid typid, int32 typmod, JsValue *jsv)
 
 			return JsonbPGetDatum(jsonb);
 		}
+		/* convert common scalar types directly, skipping the typio call */
+		else if (populate_scalar_jsonb_binary(typid, typmod, jbv, &res))
+			return res;
 		/* convert jsonb to string for typio call */
 		else if (typid == JSONOID && jbv->type != jbvBinary)
 		{
@@ -3159,6 +3306,8 @@ allocate_record_info(MemoryContext mcxt, int ncolumns)
 	data->record_type = InvalidOid;
 	data->record_typmod = 0;
 	data->ncolumns = ncolumns;
+	data->sorted_columns = NULL;
+	data->nsorted_columns = 0;
 	MemSet(data->columns, 0, sizeof(ColumnIOData) * ncolumns);
 
 	return data;
@@ -3191,6 +3340,130 @@ JsObjectGetField(JsObject *obj, char *field, JsValue *jsv)
 	}
 }
 
+/*
+ * qsort_arg() comparator to order column indexes by column names the same way
+ * as jsonb object keys are ordered: by length first, then bytewise.
+ */
+static int
+column_name_cmp(const void *a, const void *b, void *arg)
+{
+	TupleDesc	tupdesc = (TupleDesc) arg;
+	const char *name1 = NameStr(TupleDescAttr(tupdesc, *(const int *) a)->attname);
+	const char *name2 = NameStr(TupleDescAttr(tupdesc, *(const int *) b)->attname);
+	int			len1 = strlen(name1);
+	int			len2 = strlen(name2);
+
+	if (len1 != len2)
+		return len1 > len2 ? 1 : -1;
+
+	return memcmp(name1, name2, len1);
+}
+
+/* compute the jsonb key order of the record columns */
+static void
+prepare_sorted_columns(RecordIOData *record, TupleDesc tupdesc,
+					   MemoryContext mcxt)
+{
+	int			i;
+
+	record->sorted_columns = MemoryContextAlloc(mcxt,
+												sizeof(int) * Max(tupdesc->natts, 1));
+	record->nsorted_columns = 0;
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		if (!TupleDescAttr(tupdesc, i)->attisdropped)
+			record->sorted_columns[record->nsorted_columns++] = i;
+	}
+
+	qsort_arg(record->sorted_columns, record->nsorted_columns, sizeof(int),
+			  column_name_cmp, tupdesc);
+}
+
+/*
+ * Look up the values of all the record columns in a jsonb object at once,
+ * setting fields[i] to the value of the i-th column stored in values[i], or
+ * to NULL if the key is absent.
+ *
+ * Object keys are stored sorted, so unless the object has many more keys
+ * than the record has columns, a merge pass over the keys and the column
+ * names sorted the same way is cheaper than a binary search per column.
+ */
+static void
+JsObjectGetJsonbFields(JsonbContainer *jbc, RecordIOData *record,
+					   TupleDesc tupdesc, JsonbValue **fields,
+					   JsonbValue *values)
+{
+	int			ncolumns = record->nsorted_columns;
+	int			col = 0;
+	JsonbIterator *it;
+	JsonbValue	v;
+	JsonbIteratorToken r;
+	int			i;
+
+	memset(fields, 0, sizeof(JsonbValue *) * tupdesc->natts);
+
+	if (JsonContainerSize(jbc) > 4 * ncolumns)
+	{
+		for (i = 0; i < ncolumns; i++)
+		{
+			int			attnum = record->sorted_columns[i];
+			char	   *colname = NameStr(TupleDescAttr(tupdesc, attnum)->attname);
+
+			fields[attnum] = getKeyJsonValueFromContainer(jbc, colname,
+														  strlen(colname),
+														  &values[attnum]);
+		}
+
+		return;
+	}
+
+	it = JsonbIteratorInit(jbc);
+
+	while (col < ncolumns &&
+		   (r = JsonbIteratorNext(&it, &v, true)) != WJB_DONE)
+	{
+		const char *colname;
+		int			cmp = -1;
+		int			match;
+
+		if (r != WJB_KEY)
+			continue;
+
+		/* skip the columns whose names are less than the key */
+		for (; col < ncolumns; col++)
+		{
+			colname = NameStr(TupleDescAttr(tupdesc,
+											record->sorted_columns[col])->attname);
+
+			cmp = (int) strlen(colname) - v.val.string.len;
+			if (cmp == 0)
+				cmp = memcmp(colname, v.val.string.val, v.val.string.len);
+			if (cmp >= 0)
+				break;
+		}
+
+		if (cmp != 0)
+			continue;
+
+		r = JsonbIteratorNext(&it, &v, true);
+		Assert(r == WJB_VALUE);
+
+		/* there may be several columns with the same name */
+		for (match = col; match < ncolumns; match++)
+		{
+			int			attnum = record->sorted_columns[match];
+
+			if (strcmp(NameStr(TupleDescAttr(tupdesc, attnum)->attname),
+					   colname) != 0)
+				break;
+
+			values[attnum] = v;
+			fields[attnum] = &values[attnum];
+		}
+	}
+}
+
 /* populate a record tuple from json/jsonb value */
 static HeapTupleHeader
 populate_record(TupleDesc tupdesc,
@@ -3202,6 +3475,8 @@ populate_record(TupleDesc tupdesc,
 	RecordIOData *record = *record_p;
 	Datum	   *values;
 	bool	   *nulls;
+	JsonbValue **jsonb_fields = NULL;
+	JsonbValue *jsonb_values = NULL;
 	HeapTuple	res;
 	int			ncolumns = tupdesc->natts;
 	int			i;
@@ -3223,6 +3498,8 @@ populate_record(TupleDesc tupdesc,
 	if (record->record_type != tupdesc->tdtypeid ||
 		record->record_typmod != tupdesc->tdtypmod)
 	{
+		if (record->sorted_columns)
+			pfree(record->sorted_columns);
 		MemSet(record, 0, offsetof(RecordIOData, columns) +
 			   ncolumns * sizeof(ColumnIOData));
 		record->record_type = tupdesc->tdtypeid;
@@ -3230,6 +3507,18 @@ populate_record(TupleDesc tupdesc,
 		record->ncolumns = ncolumns;
 	}
 
+	/* look up all the jsonb fields at once */
+	if (!obj->is_json && obj->val.jsonb_cont)
+	{
+		if (!record->sorted_columns)
+			prepare_sorted_columns(record, tupdesc, mcxt);
+
+		jsonb_fields = palloc(ncolumns * sizeof(JsonbValue *));
+		jsonb_values = palloc(ncolumns * sizeof(JsonbValue));
+		JsObjectGetJsonbFields(obj->val.jsonb_cont, record, tupdesc,
+							   jsonb_fields, jsonb_values);
+	}
+
 	values = (Datum *) palloc(ncolumns * sizeof(Datum));
 	nulls = (bool *) palloc(ncolumns * sizeof(bool));
 
@@ -3269,7 +3558,14 @@ populate_record(TupleDesc tupdesc,
 			continue;
 		}
 
-		found = JsObjectGetField(obj, colname, &field);
+		if (jsonb_fields)
+		{
+			field.is_json = false;
+			field.val.jsonb = jsonb_fields[i];
+			found = jsonb_fields[i] != NULL;
+		}
+		else
+			found = JsObjectGetField(obj, colname, &field);
 
 		/*
 		 * we can't just skip here if the key wasn't found since we might have
@@ -3296,6 +3592,11 @@ populate_record(TupleDesc tupdesc,
 
 	pfree(values);
 	pfree(nulls);
+	if (jsonb_fields)
+	{
+		pfree(jsonb_fields);
+		pfree(jsonb_values);
+	}
 
 	return res->t_data;
 }
@@ -5494,3 +5795,233 @@ json_get_first_token(text *json, bool throw_error)
 
 	return JSON_TOKEN_INVALID;	/* invalid json */
 }
+
+/*
+ * Conversion plans for composite_to_json() and composite_to_jsonb().
+ *
+ * Those functions are reached recursively without an fcinfo, so the plans
+ * are cached in a backend-local hash keyed by rowtype rather than in
+ * fn_extra.  A plan is rebuilt when the rowtype's tupdesc is replaced, and
+ * entries are evicted when the pg_type row of their rowtype changes (this
+ * includes the type being dropped) or when any pg_cast row changes.
+ *
+ * A plan stays valid while it is in use even if its entry is evicted, so
+ * every json_composite_plan_acquire() must be matched by a
+ * json_composite_plan_release(), also on error.
+ */
+typedef struct JsonCompositePlanKey
+{
+	Oid			typid;
+	int32		typmod;
+	bool		is_jsonb;
+} JsonCompositePlanKey;
+
+typedef struct JsonCompositePlanEntry
+{
+	JsonCompositePlanKey key;	/* hash key (must be first) */
+	uint32		typhash;		/* syscache hash value of key.typid */
+	JsonCompositePlan *plan;
+} JsonCompositePlanEntry;
+
+static HTAB *json_composite_plans = NULL;
+static uint32 json_composite_plans_inval_count = 0;
+
+/* Free the plan, or arrange for its last user to free it */
+static void
+json_composite_plan_discard(JsonCompositePlan *plan)
+{
+	if (plan->refcount > 0)
+		plan->obsolete = true;
+	else
+		MemoryContextDelete(plan->mcxt);
+}
+
+/* Syscache invalidation callback for pg_type and pg_cast */
+static void
+json_composite_plans_invalidate(Datum arg, int cacheid, uint32 hashvalue)
+{
+	HASH_SEQ_STATUS status;
+	JsonCompositePlanEntry *entry;
+
+	json_composite_plans_inval_count++;
+
+	hash_seq_init(&status, json_composite_plans);
+	while ((entry = (JsonCompositePlanEntry *) hash_seq_search(&status)) != NULL)
+	{
+		/*
+		 * A pg_cast change can recategorize attributes of any rowtype.  The
+		 * categories of the attributes cannot change through pg_type without
+		 * the rowtype itself changing too, which replaces its tupdesc.
+		 */
+		if (cacheid == TYPEOID && hashvalue != 0 && entry->typhash != hashvalue)
+			continue;
+
+		json_composite_plan_discard(entry->plan);
+
+		if (hash_search(json_composite_plans, &entry->key,
+						HASH_REMOVE, NULL) == NULL)
+			elog(ERROR, "hash table corrupted");
+	}
+}
+
+/* Build conversion plan for the rowtype described by "tupdesc" */
+static JsonCompositePlan *
+json_composite_plan_build(TupleDesc tupdesc, uint64 tupdesc_id, bool is_jsonb,
+						  JsonCategorizeTypeFunc categorize)
+{
+	MemoryContext mcxt;
+	MemoryContext oldcxt;
+	JsonCompositePlan *plan;
+	int			i;
+
+	/* the context is reparented to CacheMemoryContext once the plan is ready */
+	mcxt = AllocSetContextCreate(CurrentMemoryContext,
+								 "json composite plan",
+								 ALLOCSET_SMALL_SIZES);
+	oldcxt = MemoryContextSwitchTo(mcxt);
+
+	plan = palloc(offsetof(JsonCompositePlan, columns) +
+				  sizeof(JsonCompositeColumn) * tupdesc->natts);
+	plan->mcxt = mcxt;
+	plan->tupdesc_id = tupdesc_id;
+	plan->refcount = 0;
+	plan->obsolete = false;
+	plan->ncolumns = 0;
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+		JsonCompositeColumn *col;
+
+		if (att->attisdropped)
+			continue;
+
+		col = &plan->columns[plan->ncolumns++];
+		col->attnum = att->attnum;
+
+		if (is_jsonb)
+		{
+			/* don't need checkStringLen here - can't exceed maximum name length */
+			col->key = pstrdup(NameStr(att->attname));
+			col->keylen = strlen(col->key);
+		}
+		else
+		{
+			StringInfoData key;
+
+			initStringInfo(&key);
+			escape_json(&key, NameStr(att->attname));
+			appendStringInfoChar(&key, ':');
+			col->key = key.data;
+			col->keylen = key.len;
+		}
+
+		categorize(att->atttypid, &col->tcategory, &col->outfuncoid);
+
+		if (OidIsValid(col->outfuncoid))
+			fmgr_info_cxt(col->outfuncoid, &col->outfunc, mcxt);
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextSetParent(mcxt, CacheMemoryContext);
+
+	return plan;
+}
+
+/*
+ * Get the json (or jsonb, if "is_jsonb") conversion plan for the rowtype
+ * described by "tupdesc", building it with "categorize" if needed.
+ */
+JsonCompositePlan *
+json_composite_plan_acquire(TupleDesc tupdesc, bool is_jsonb,
+							JsonCategorizeTypeFunc categorize)
+{
+	JsonCompositePlanKey key;
+	JsonCompositePlanEntry *entry;
+	JsonCompositePlan *plan;
+	uint64		tupdesc_id;
+
+	if (json_composite_plans == NULL)
+	{
+		HASHCTL		ctl;
+
+		if (!CacheMemoryContext)
+			CreateCacheMemoryContext();
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(JsonCompositePlanKey);
+		ctl.entrysize = sizeof(JsonCompositePlanEntry);
+		ctl.hcxt = CacheMemoryContext;
+
+		json_composite_plans = hash_create("json composite plans", 16, &ctl,
+										   HASH_ELEM | HASH_BLOBS |
+										   HASH_CONTEXT);
+
+		CacheRegisterSyscacheCallback(TYPEOID,
+									  json_composite_plans_invalidate,
+									  (Datum) 0);
+		CacheRegisterSyscacheCallback(CASTSOURCETARGET,
+									  json_composite_plans_invalidate,
+									  (Datum) 0);
+	}
+
+	/* zero the padding, the key is hashed as a blob */
+	memset(&key, 0, sizeof(key));
+	key.typid = tupdesc->tdtypeid;
+	key.typmod = tupdesc->tdtypmod;
+	key.is_jsonb = is_jsonb;
+
+	tupdesc_id = assign_record_type_identifier(key.typid, key.typmod);
+
+	entry = hash_search(json_composite_plans, &key, HASH_FIND, NULL);
+
+	if (entry && entry->plan->tupdesc_id != tupdesc_id)
+	{
+		/* the rowtype has changed since the plan was built */
+		json_composite_plan_discard(entry->plan);
+
+		if (hash_search(json_composite_plans, &key, HASH_REMOVE, NULL) == NULL)
+			elog(ERROR, "hash table corrupted");
+
+		entry = NULL;
+	}
+
+	if (entry)
+		plan = entry->plan;
+	else
+	{
+		uint32		inval_count = json_composite_plans_inval_count;
+
+		plan = json_composite_plan_build(tupdesc, tupdesc_id, is_jsonb,
+										 categorize);
+
+		/*
+		 * Don't cache the plan if an invalidation arrived while it was being
+		 * built, it might have been missed.  The plan is still good enough
+		 * for the current call.
+		 */
+		if (inval_count == json_composite_plans_inval_count)
+		{
+			entry = hash_search(json_composite_plans, &key, HASH_ENTER, NULL);
+			entry->typhash = GetSysCacheHashValue1(TYPEOID,
+												   ObjectIdGetDatum(key.typid));
+			entry->plan = plan;
+		}
+		else
+			plan->obsolete = true;
+	}
+
+	plan->refcount++;
+
+	return plan;
+}
+
+/* Release a plan acquired by json_composite_plan_acquire() */
+void
+json_composite_plan_release(JsonCompositePlan *plan)
+{
+	Assert(plan->refcount > 0);
+
+	if (--plan->refcount == 0 && plan->obsolete)
+		MemoryContextDelete(plan->mcxt);
+}
@@ -64,17 +64,48 @@
 #include "postgres.h"
 
 #include "funcapi.h"
+#include "lib/ilist.h"
 #include "lib/stringinfo.h"
 #include "libpq/pqformat.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
 #include "utils/builtins.h"
+#include "utils/catcache.h"
 #include "utils/formatting.h"
+#include "utils/hsearch.h"
 #include "utils/json.h"
 #include "utils/jsonpath.h"
+#include "utils/memutils.h"
 
 
+/*
+ * Cache of recently parsed jsonpath strings.
+ *
+ * A path passed as a text parameter and cast to jsonpath, or built per row
+ * from a few templates, is parsed again on every execution.  So we keep the
+ * binary representations of the last JSONPATH_CACHE_SIZE distinct strings,
+ * evicting the least recently used one.  Parsing doesn't depend on anything
+ * but the string, so entries never have to be invalidated.  Long strings are
+ * not cached, to keep the entries small.
+ */
+#define JSONPATH_CACHE_SIZE		64
+#define JSONPATH_CACHE_MAX_LEN	127
+
+typedef struct JsonPathCacheEntry
+{
+	char		str[JSONPATH_CACHE_MAX_LEN + 1];	/* hash key, must be first */
+	JsonPath   *path;			/* allocated in CacheMemoryContext */
+	dlist_node	lru_node;		/* in jsonpath_cache_lru */
+} JsonPathCacheEntry;
+
+static HTAB *jsonpath_cache = NULL;
+
+/* cache entries, most recently used first */
+static dlist_head jsonpath_cache_lru = DLIST_STATIC_INIT(jsonpath_cache_lru);
+
 static Datum jsonPathFromCstring(char *in, int len);
+static JsonPath *jsonPathCacheLookup(const char *str);
+static void jsonPathCacheInsert(const char *str, JsonPath *path);
 static char *jsonPathToCstring(StringInfo out, JsonPath *in,
 							   int estimated_len);
 static int	flattenJsonPathParseItem(StringInfo buf, JsonPathParseItem *item,
@@ -164,14 +195,23 @@ jsonpath_send(PG_FUNCTION_ARGS)
  *
  * Uses jsonpath parser to turn string into an AST, then
  * flattenJsonPathParseItem() does second pass turning AST into binary
- * representation of jsonpath.
+ * representation of jsonpath.  Both are skipped if the string is found in
+ * the cache.
  */
 static Datum
 jsonPathFromCstring(char *in, int len)
 {
-	JsonPathParseResult *jsonpath = parsejsonpath(in, len);
+	JsonPathParseResult *jsonpath;
 	JsonPath   *res;
 	StringInfoData buf;
+	bool		cacheable;
+
+	cacheable = len <= JSONPATH_CACHE_MAX_LEN && strlen(in) == len;
+
+	if (cacheable && (res = jsonPathCacheLookup(in)) != NULL)
+		PG_RETURN_JSONPATH_P(res);
+
+	jsonpath = parsejsonpath(in, len);
 
 	initStringInfo(&buf);
 	enlargeStringInfo(&buf, 4 * len /* estimation */ );
@@ -192,9 +232,85 @@ jsonPathFromCstring(char *in, int len)
 	if (jsonpath->lax)
 		res->header |= JSONPATH_LAX;
 
+	if (cacheable)
+		jsonPathCacheInsert(in, res);
+
 	PG_RETURN_JSONPATH_P(res);
 }
 
+/*
+ * Look up a jsonpath string in the cache.  Returns a palloc'd copy of its
+ * binary representation, or NULL if it is not cached.
+ */
+static JsonPath *
+jsonPathCacheLookup(const char *str)
+{
+	JsonPathCacheEntry *entry;
+	JsonPath   *res;
+
+	if (jsonpath_cache == NULL)
+		return NULL;
+
+	entry = hash_search(jsonpath_cache, str, HASH_FIND, NULL);
+
+	if (entry == NULL)
+		return NULL;
+
+	dlist_move_head(&jsonpath_cache_lru, &entry->lru_node);
+
+	res = palloc(VARSIZE(entry->path));
+	memcpy(res, entry->path, VARSIZE(entry->path));
+
+	return res;
+}
+
+/*
+ * Remember the binary representation of a jsonpath string.
+ */
+static void
+jsonPathCacheInsert(const char *str, JsonPath *path)
+{
+	JsonPathCacheEntry *entry;
+	JsonPath   *copy;
+	bool		found;
+
+	if (jsonpath_cache == NULL)
+	{
+		HASHCTL		ctl;
+
+		if (!CacheMemoryContext)
+			CreateCacheMemoryContext();
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = JSONPATH_CACHE_MAX_LEN + 1;
+		ctl.entrysize = sizeof(JsonPathCacheEntry);
+		ctl.hcxt = CacheMemoryContext;
+
+		jsonpath_cache = hash_create("jsonpath cache", JSONPATH_CACHE_SIZE,
+									 &ctl, HASH_ELEM | HASH_CONTEXT);
+	}
+
+	/* Make room for the new entry by evicting the least recently used one */
+	if (hash_get_num_entries(jsonpath_cache) >= JSONPATH_CACHE_SIZE)
+	{
+		entry = dlist_container(JsonPathCacheEntry, lru_node,
+								dlist_tail_node(&jsonpath_cache_lru));
+
+		dlist_delete(&entry->lru_node);
+		pfree(entry->path);
+		hash_search(jsonpath_cache, entry->str, HASH_REMOVE, NULL);
+	}
+
+	copy = MemoryContextAlloc(CacheMemoryContext, VARSIZE(path));
+	memcpy(copy, path, VARSIZE(path));
+
+	entry = hash_search(jsonpath_cache, str, HASH_ENTER, &found);
+	Assert(!found);
+
+	entry->path = copy;
+	dlist_push_head(&jsonpath_cache_lru, &entry->lru_node);
+}
+
 /*
  * Converts jsonpath value to a C-string.
  *
@@ -1312,6 +1428,153 @@ jspIsMutableWalker(JsonPathItem *jpi, JsonPathMutableContext *cxt)
 	return status;
 }
 
+/*
+ * Estimate relative cost of evaluation of jsonpath expression 'jsp' and all
+ * its following items.
+ *
+ * The estimate is used for choosing the evaluation order of && and ||
+ * operands, so only the ratio between costs of different expressions is
+ * meaningful.  Iteration over arrays and objects, .** descents, LIKE_REGEX
+ * and .datetime() are considered expensive, accessors, literals and
+ * comparisons are considered cheap.
+ *
+ * Expression features which affect evaluation errors are reported in
+ * '*flags' (see JSP_COST_XXX).
+ */
+int
+jspEstimateCost(JsonPathItem *jsp, int *flags)
+{
+	JsonPathItem next;
+	JsonPathItem arg;
+	int			cost = 0;
+
+	check_stack_depth();
+
+	for (;;)
+	{
+		switch (jsp->type)
+		{
+			case jpiVariable:
+				*flags |= JSP_COST_HAS_VARIABLES;
+				cost += 1;
+				break;
+
+			case jpiNull:
+			case jpiString:
+			case jpiNumeric:
+			case jpiBool:
+			case jpiRoot:
+			case jpiCurrent:
+			case jpiKey:
+			case jpiLast:
+			case jpiType:
+			case jpiSize:
+				cost += 1;
+				break;
+
+			case jpiAbs:
+			case jpiFloor:
+			case jpiCeiling:
+				cost += 2;
+				break;
+
+			case jpiDouble:
+				cost += 10;
+				break;
+
+			case jpiAnyArray:
+			case jpiAnyKey:
+				cost += 10;
+				break;
+
+			case jpiKeyValue:
+				cost += 20;
+				break;
+
+			case jpiAny:
+				cost += 100;
+				break;
+
+			case jpiIndexArray:
+				cost += 2;
+
+				for (int i = 0; i < jsp->content.array.nelems; i++)
+				{
+					JsonPathItem from;
+					JsonPathItem to;
+
+					if (jspGetArraySubscript(jsp, &from, &to, i))
+						cost += jspEstimateCost(&to, flags) + 10;
+
+					cost += jspEstimateCost(&from, flags);
+				}
+				break;
+
+			case jpiDatetime:
+				*flags |= JSP_COST_HAS_DATETIME;
+				cost += 50;
+
+				if (jsp->content.arg)
+				{
+					jspGetArg(jsp, &arg);
+					cost += jspEstimateCost(&arg, flags);
+				}
+				break;
+
+			case jpiLikeRegex:
+				jspInitByBuffer(&arg, jsp->base, jsp->content.like_regex.expr);
+				cost += 100 + jspEstimateCost(&arg, flags);
+				break;
+
+			case jpiFilter:
+				jspGetArg(jsp, &arg);
+				cost += 10 + jspEstimateCost(&arg, flags);
+				break;
+
+			case jpiNot:
+			case jpiIsUnknown:
+			case jpiExists:
+			case jpiPlus:
+			case jpiMinus:
+				jspGetArg(jsp, &arg);
+				cost += 1 + jspEstimateCost(&arg, flags);
+				break;
+
+			case jpiStartsWith:
+				cost += 5;
+				/* FALLTHROUGH */
+			case jpiAnd:
+			case jpiOr:
+			case jpiEqual:
+			case jpiNotEqual:
+			case jpiLess:
+			case jpiGreater:
+			case jpiLessOrEqual:
+			case jpiGreaterOrEqual:
+			case jpiAdd:
+			case jpiSub:
+			case jpiMul:
+			case jpiDiv:
+			case jpiMod:
+				jspGetLeftArg(jsp, &arg);
+				cost += 1 + jspEstimateCost(&arg, flags);
+				jspGetRightArg(jsp, &arg);
+				cost += jspEstimateCost(&arg, flags);
+				break;
+
+			default:
+				elog(ERROR, "unrecognized jsonpath item type: %d", jsp->type);
+		}
+
+		if (!jspGetNext(jsp, &next))
+			break;
+
+		jsp = &next;
+	}
+
+	return cost;
+}
+
 /*
  * Check whether jsonpath expression is immutable or not.
  */
@@ -61,6 +61,7 @@
 
 #include "catalog/pg_collation.h"
 #include "catalog/pg_type.h"
+#include "common/int.h"
 #include "executor/execExpr.h"
 #include "funcapi.h"
 #include "lib/stringinfo.h"
@@ -93,6 +94,18 @@ typedef struct JsonBaseObjectInfo
 typedef int (*JsonPathVarCallback) (void *vars, char *varName, int varNameLen,
 									JsonbValue *val, JsonbValue *baseObject);
 
+/*
+ * Value of a variable reference, resolved on its first evaluation.
+ */
+typedef struct JsonPathVarSlot
+{
+	int32		pos;			/* position of the jpiVariable item in
+								 * pathData */
+	int			baseObjectId;	/* result of JsonPathVarCallback */
+	JsonbValue	value;
+	JsonbValue	baseObject;
+} JsonPathVarSlot;
+
 /*
  * Context of jsonpath execution.
  */
@@ -116,8 +129,36 @@ typedef struct JsonPathExecContext
 	bool		throwErrors;	/* with "false" all suppressible errors are
 								 * suppressed */
 	bool		useTz;
+	char	   *pathData;		/* data of the jsonpath being executed */
+	int32		pathLen;		/* length of pathData */
+	char	   *boolArgsOrder;	/* evaluation order of && and || arguments
+								 * indexed by item position in pathData, see
+								 * swapBoolItemArgs() */
+	JsonPathVarSlot *varSlots;	/* resolved variable references, see
+								 * getJsonPathVariable() */
+	int			nvarSlots;
+	int			varSlotsSize;
 } JsonPathExecContext;
 
+/*
+ * Positions of all occurrences of a key in the binary representation of a
+ * container searched by .** accessor, see executeAnyItem().
+ */
+typedef struct JsonPathKeyFilter
+{
+	char	   *key;
+	int			keylen;
+	char	  **occurrences;	/* in ascending order */
+	int			noccurrences;
+} JsonPathKeyFilter;
+
+/*
+ * Key filters are only built for containers of at least this size, and are
+ * abandoned if the key occurs too many times to be selective.
+ */
+#define JSONPATH_KEY_FILTER_MIN_SIZE	1024
+#define JSONPATH_KEY_FILTER_MAX_OCCURRENCES	1024
+
 /* Context for LIKE_REGEX execution. */
 typedef struct JsonLikeRegexContext
 {
@@ -159,19 +200,67 @@ typedef struct JsonValueListIterator
 	ListCell   *next;
 } JsonValueListIterator;
 
+/*
+ * State of streaming evaluation of a chain of key and array accessors over
+ * json text, see executeJsonPathOnText().
+ */
+typedef struct JsonTextPathState
+{
+	JsonLexContext *lex;
+	int			npath;			/* number of accessors in the chain */
+	char	  **keys;			/* key names, NULL for array accessors */
+	int		   *keylens;		/* key name lengths */
+	int		   *indexes;		/* array subscripts */
+	bool	   *pathok;			/* is the value at this level on the path? */
+	int		   *curindex;		/* current element index of arrays */
+	char	   *result_start;	/* start of the value being matched */
+	char	   *result;			/* text of the matched value, or NULL */
+	int			resultlen;
+	bool		mismatch;		/* accessor was applied to the item of
+								 * unexpected type */
+} JsonTextPathState;
+
 /* Structures for JSON_TABLE execution  */
 typedef struct JsonTableScanState JsonTableScanState;
 typedef struct JsonTableJoinState JsonTableJoinState;
 
+typedef struct JsonTableItemList JsonTableItemList;
+
+/* Item of a JSON_TABLE scan with the memoized items of its nested scans */
+typedef struct JsonTableScanItem
+{
+	Datum		value;			/* item converted to jsonb, or 0 if not yet */
+	JsonTableItemList **nested;	/* items of nested scans, by childno */
+} JsonTableScanItem;
+
+/* Items found by the path of a JSON_TABLE scan for one parent item */
+struct JsonTableItemList
+{
+	JsonValueList found;
+	JsonTableScanItem *items;	/* per found item, allocated on first use */
+};
+
+/* JSON_TABLE column with the simple path '$.key' */
+typedef struct JsonTableSimpleColumn
+{
+	char	   *key;
+	int			keylen;
+	int			colnum;
+} JsonTableSimpleColumn;
+
 struct JsonTableScanState
 {
 	JsonTableScanState *parent;
 	JsonTableJoinState *nested;
-	MemoryContext mcxt;
+	MemoryContext mcxt;			/* for the items below the current root item */
 	JsonPath   *path;
 	List	   *args;
-	JsonValueList found;
+	JsonTableItemList *list;	/* items for the current parent item */
 	JsonValueListIterator iter;
+	JsonTableScanItem *item;	/* the current item */
+	JsonTableScanItem rootItem;	/* the current item of the root scan */
+	int			childno;		/* index among nested scans of the parent */
+	int			nchildren;		/* number of nested scans */
 	Datum		current;
 	int			ordinal;
 	bool		currentIsNull;
@@ -179,8 +268,17 @@ struct JsonTableScanState
 	bool		errorOnError;
 	bool		advanceNested;
 	bool		reset;
+	ParallelTableFuncScanState *pstate;	/* for parallel scan of root path */
+	int			chunkEnd;		/* end of the items claimed from pstate */
+	JsonTableSimpleColumn *simpleColumns;	/* sorted by key */
+	int			nsimpleColumns;
+	bool		columnsExtracted;	/* simple columns of the current item
+									 * are already extracted */
 };
 
+/* number of root path items claimed at once by a parallel JSON_TABLE scan */
+#define JSON_TABLE_PARALLEL_CHUNK_SIZE	64
+
 struct JsonTableJoinState
 {
 	union
@@ -207,7 +305,10 @@ typedef struct JsonTableContext
 	{
 		ExprState  *expr;
 		JsonTableScanState *scan;
+		JsonbValue *item;		/* item extracted for a simple column */
+		JsonbValue	itembuf;
 	}		   *colexprs;
+	MemoryContext doccxt;		/* for the items of the root path */
 	JsonTableScanState root;
 	bool		empty;
 } JsonTableContext;
@@ -255,12 +356,22 @@ static JsonPathExecResult executeItemOptUnwrapResultNoThrow(JsonPathExecContext
 															JsonbValue *jb, bool unwrap, JsonValueList *found);
 static JsonPathBool executeBoolItem(JsonPathExecContext *cxt,
 									JsonPathItem *jsp, JsonbValue *jb, bool canHaveNext);
+static bool swapBoolItemArgs(JsonPathExecContext *cxt, JsonPathItem *jsp);
 static JsonPathBool executeNestedBoolItem(JsonPathExecContext *cxt,
 										  JsonPathItem *jsp, JsonbValue *jb);
 static JsonPathExecResult executeAnyItem(JsonPathExecContext *cxt,
 										 JsonPathItem *jsp, JsonbContainer *jbc, JsonValueList *found,
 										 uint32 level, uint32 first, uint32 last,
-										 bool ignoreStructuralErrors, bool unwrapNext);
+										 bool ignoreStructuralErrors, bool unwrapNext,
+										 JsonPathKeyFilter *keyFilter);
+static bool initKeyFilter(JsonPathExecContext *cxt, JsonPathKeyFilter *filter,
+						  JsonPathItem *jsp, JsonbValue *jb);
+static bool keyFilterMayMatch(JsonPathKeyFilter *filter, JsonbValue *jb);
+static bool getRequiredKey(JsonPathExecContext *cxt, JsonPathItem *jsp,
+						   char **key, int *keylen);
+static bool getPredicateRequiredKey(JsonPathItem *pred, char **key,
+									int *keylen);
+static bool getCurrentItemKey(JsonPathItem *jsp, char **key, int *keylen);
 static JsonPathBool executePredicate(JsonPathExecContext *cxt,
 									 JsonPathItem *pred, JsonPathItem *larg, JsonPathItem *rarg,
 									 JsonbValue *jb, bool unwrapRightArg,
@@ -268,6 +379,8 @@ static JsonPathBool executePredicate(JsonPathExecContext *cxt,
 static JsonPathExecResult executeBinaryArithmExpr(JsonPathExecContext *cxt,
 												  JsonPathItem *jsp, JsonbValue *jb,
 												  BinaryArithmFunc func, JsonValueList *found);
+static bool executeIntegerArithm(JsonPathItemType op, Numeric lnum,
+								 Numeric rnum, Numeric *res);
 static JsonPathExecResult executeUnaryArithmExpr(JsonPathExecContext *cxt,
 												 JsonPathItem *jsp, JsonbValue *jb, PGFunction func,
 												 JsonValueList *found);
@@ -319,6 +432,22 @@ static JsonbValue *getScalar(JsonbValue *scalar, enum jbvType type);
 static JsonbValue *wrapItemsInArray(const JsonValueList *items);
 static int	compareDatetime(Datum val1, Oid typid1, Datum val2, Oid typid2,
 							bool useTz, bool *have_error);
+static JsonPathExecResult executeJsonPathForItem(JsonPath *path, List *vars,
+												 Datum item, Oid typid,
+												 bool throwErrors,
+												 JsonValueList *result);
+static bool executeJsonPathOnText(JsonPath *path, text *json,
+								  JsonValueList *result,
+								  JsonPathExecResult *res);
+static void jsonTextPathMatchStart(JsonTextPathState *state, int lex_level);
+static void jsonTextPathMatchEnd(JsonTextPathState *state, int lex_level);
+static bool jsonTextPathKeyMatches(JsonTextPathState *state, char *fname);
+static void jsonTextPathObjectStart(void *state);
+static void jsonTextPathArrayStart(void *state);
+static void jsonTextPathFieldStart(void *state, char *fname, bool isnull);
+static void jsonTextPathFieldEnd(void *state, char *fname, bool isnull);
+static void jsonTextPathElementStart(void *state, bool isnull);
+static void jsonTextPathElementEnd(void *state, bool isnull);
 
 
 static JsonTableJoinState *JsonTableInitPlanState(JsonTableContext *cxt,
@@ -640,6 +769,12 @@ executeJsonPath(JsonPath *path, void *vars, JsonPathVarCallback getVar,
 	cxt.innermostArraySize = -1;
 	cxt.throwErrors = throwErrors;
 	cxt.useTz = useTz;
+	cxt.pathData = path->data;
+	cxt.pathLen = VARSIZE(path) - JSONPATH_HDRSZ;
+	cxt.boolArgsOrder = NULL;
+	cxt.varSlots = NULL;
+	cxt.nvarSlots = 0;
+	cxt.varSlotsSize = 0;
 
 	if (jspStrictAbsenseOfErrors(&cxt) && !result)
 	{
@@ -914,9 +1049,7 @@ executeItemOptUnwrapTarget(JsonPathExecContext *cxt, JsonPathItem *jsp,
 				lastjbv = hasNext ? &tmpjbv : palloc(sizeof(*lastjbv));
 
 				lastjbv->type = jbvNumeric;
-				lastjbv->val.numeric =
-					DatumGetNumeric(DirectFunctionCall1(int4_numeric,
-														Int32GetDatum(last)));
+				lastjbv->val.numeric = int64_to_numeric(last);
 
 				res = executeNextItem(cxt, jsp, &elem,
 									  lastjbv, found, hasNext);
@@ -934,7 +1067,7 @@ executeItemOptUnwrapTarget(JsonPathExecContext *cxt, JsonPathItem *jsp,
 				return executeAnyItem
 					(cxt, hasNext ? &elem : NULL,
 					 jb->val.binary.data, found, 1, 1, 1,
-					 false, jspAutoUnwrap(cxt));
+					 false, jspAutoUnwrap(cxt), NULL);
 			}
 			else if (unwrap && JsonbType(jb) == jbvArray)
 				return executeItemUnwrapTargetArray(cxt, jsp, jb, found, false);
@@ -1012,13 +1145,25 @@ executeItemOptUnwrapTarget(JsonPathExecContext *cxt, JsonPathItem *jsp,
 				}
 
 				if (jb->type == jbvBinary)
+				{
+					JsonPathKeyFilter keyFilter;
+					bool		useKeyFilter;
+
+					useKeyFilter = hasNext &&
+						initKeyFilter(cxt, &keyFilter, &elem, jb);
+
 					res = executeAnyItem
 						(cxt, hasNext ? &elem : NULL,
 						 jb->val.binary.data, found,
 						 1,
 						 jsp->content.anybounds.first,
 						 jsp->content.anybounds.last,
-						 true, jspAutoUnwrap(cxt));
+						 true, jspAutoUnwrap(cxt),
+						 useKeyFilter ? &keyFilter : NULL);
+
+					if (useKeyFilter)
+						pfree(keyFilter.occurrences);
+				}
 				break;
 			}
 
@@ -1084,9 +1229,7 @@ executeItemOptUnwrapTarget(JsonPathExecContext *cxt, JsonPathItem *jsp,
 				jb = palloc(sizeof(*jb));
 
 				jb->type = jbvNumeric;
-				jb->val.numeric =
-					DatumGetNumeric(DirectFunctionCall1(int4_numeric,
-														Int32GetDatum(size)));
+				jb->val.numeric = int64_to_numeric(size);
 
 				res = executeNextItem(cxt, jsp, NULL, jb, found, false);
 			}
@@ -1114,22 +1257,33 @@ executeItemOptUnwrapTarget(JsonPathExecContext *cxt, JsonPathItem *jsp,
 
 				if (jb->type == jbvNumeric)
 				{
-					char	   *tmp = DatumGetCString(DirectFunctionCall1(numeric_out,
-																		  NumericGetDatum(jb->val.numeric)));
-					double		val;
-					bool		have_error = false;
-
-					val = float8in_internal_opt_error(tmp,
-													  NULL,
-													  "double precision",
-													  tmp,
-													  &have_error);
+					int64		ival;
+
+					/*
+					 * Only the range of the value needs to be checked here,
+					 * the item itself is passed further unchanged.  Small
+					 * integers always fit, so skip text conversion for them.
+					 */
+					if (!numeric_get_int64(jb->val.numeric, &ival))
+					{
+						char	   *tmp = DatumGetCString(DirectFunctionCall1(numeric_out,
+																			  NumericGetDatum(jb->val.numeric)));
+						double		val;
+						bool		have_error = false;
+
+						val = float8in_internal_opt_error(tmp,
+														  NULL,
+														  "double precision",
+														  tmp,
+														  &have_error);
+
+						if (have_error || isinf(val) || isnan(val))
+							RETURN_ERROR(ereport(ERROR,
+												 (errcode(ERRCODE_NON_NUMERIC_SQL_JSON_ITEM),
+												  errmsg("numeric argument of jsonpath item method .%s() is out of range for type double precision",
+														 jspOperationName(jsp->type)))));
+					}
 
-					if (have_error || isinf(val) || isnan(val))
-						RETURN_ERROR(ereport(ERROR,
-											 (errcode(ERRCODE_NON_NUMERIC_SQL_JSON_ITEM),
-											  errmsg("numeric argument of jsonpath item method .%s() is out of range for type double precision",
-													 jspOperationName(jsp->type)))));
 					res = jperOk;
 				}
 				else if (jb->type == jbvString)
@@ -1204,7 +1358,7 @@ executeItemUnwrapTargetArray(JsonPathExecContext *cxt, JsonPathItem *jsp,
 
 	return executeAnyItem
 		(cxt, jsp, jb->val.binary.data, found, 1, 1, 1,
-		 false, unwrapElements);
+		 false, unwrapElements, NULL);
 }
 
 /*
@@ -1309,7 +1463,17 @@ executeBoolItem(JsonPathExecContext *cxt, JsonPathItem *jsp,
 	switch (jsp->type)
 	{
 		case jpiAnd:
-			jspGetLeftArg(jsp, &larg);
+			if (swapBoolItemArgs(cxt, jsp))
+			{
+				jspGetRightArg(jsp, &larg);
+				jspGetLeftArg(jsp, &rarg);
+			}
+			else
+			{
+				jspGetLeftArg(jsp, &larg);
+				jspGetRightArg(jsp, &rarg);
+			}
+
 			res = executeBoolItem(cxt, &larg, jb, false);
 
 			if (res == jpbFalse)
@@ -1320,19 +1484,27 @@ executeBoolItem(JsonPathExecContext *cxt, JsonPathItem *jsp,
 			 * jperError
 			 */
 
-			jspGetRightArg(jsp, &rarg);
 			res2 = executeBoolItem(cxt, &rarg, jb, false);
 
 			return res2 == jpbTrue ? res : res2;
 
 		case jpiOr:
-			jspGetLeftArg(jsp, &larg);
+			if (swapBoolItemArgs(cxt, jsp))
+			{
+				jspGetRightArg(jsp, &larg);
+				jspGetLeftArg(jsp, &rarg);
+			}
+			else
+			{
+				jspGetLeftArg(jsp, &larg);
+				jspGetRightArg(jsp, &rarg);
+			}
+
 			res = executeBoolItem(cxt, &larg, jb, false);
 
 			if (res == jpbTrue)
 				return jpbTrue;
 
-			jspGetRightArg(jsp, &rarg);
 			res2 = executeBoolItem(cxt, &rarg, jb, false);
 
 			return res2 == jpbFalse ? res : res2;
@@ -1423,6 +1595,54 @@ executeBoolItem(JsonPathExecContext *cxt, JsonPathItem *jsp,
 	}
 }
 
+/*
+ * Check whether operands of && or || should be evaluated in reverse order.
+ *
+ * The result of three-valued && and || does not depend on the order of
+ * operands, and errors inside predicates are converted into unknown, so it
+ * is beneficial to evaluate the cheaper operand first, because the other one
+ * can be skipped then.  Operands with variables, and with .datetime() when
+ * timezone usage is not allowed, are never reordered, because they can throw
+ * errors which are not suppressed in predicates: absence of a variable or
+ * comparison of zoned and non-zoned datetime values.
+ *
+ * The decision is made once for each item on its first evaluation.
+ */
+static bool
+swapBoolItemArgs(JsonPathExecContext *cxt, JsonPathItem *jsp)
+{
+	int32		pos = jsp->base - cxt->pathData;
+
+	Assert(jsp->type == jpiAnd || jsp->type == jpiOr);
+	Assert(pos >= 0 && pos < cxt->pathLen);
+
+	if (!cxt->boolArgsOrder)
+		cxt->boolArgsOrder = palloc0(cxt->pathLen);
+
+	if (!cxt->boolArgsOrder[pos])
+	{
+		JsonPathItem arg;
+		int			flags = 0;
+		int			unsafe = JSP_COST_HAS_VARIABLES;
+		int			lcost;
+		int			rcost;
+
+		if (!cxt->useTz)
+			unsafe |= JSP_COST_HAS_DATETIME;
+
+		jspGetLeftArg(jsp, &arg);
+		lcost = jspEstimateCost(&arg, &flags);
+
+		jspGetRightArg(jsp, &arg);
+		rcost = jspEstimateCost(&arg, &flags);
+
+		cxt->boolArgsOrder[pos] =
+			!(flags & unsafe) && rcost < lcost ? 'r' : 'l';
+	}
+
+	return cxt->boolArgsOrder[pos] == 'r';
+}
+
 /*
  * Execute nested (filters etc.) boolean expression pushing current SQL/JSON
  * item onto the stack.
@@ -1447,11 +1667,15 @@ executeNestedBoolItem(JsonPathExecContext *cxt, JsonPathItem *jsp,
  *  - jpiAny (.** accessor),
  *  - jpiAnyKey (.* accessor),
  *  - jpiAnyArray ([*] accessor)
+ *
+ * If 'keyFilter' is given, items which can't contain the required key of
+ * 'jsp' are skipped together with their descendants.
  */
 static JsonPathExecResult
 executeAnyItem(JsonPathExecContext *cxt, JsonPathItem *jsp, JsonbContainer *jbc,
 			   JsonValueList *found, uint32 level, uint32 first, uint32 last,
-			   bool ignoreStructuralErrors, bool unwrapNext)
+			   bool ignoreStructuralErrors, bool unwrapNext,
+			   JsonPathKeyFilter *keyFilter)
 {
 	JsonPathExecResult res = jperNotFound;
 	JsonbIterator *it;
@@ -1478,6 +1702,8 @@ executeAnyItem(JsonPathExecContext *cxt, JsonPathItem *jsp, JsonbContainer *jbc,
 
 		if (r == WJB_VALUE || r == WJB_ELEM)
 		{
+			if (keyFilter && !keyFilterMayMatch(keyFilter, &v))
+				continue;
 
 			if (level >= first ||
 				(first == PG_UINT32_MAX && last == PG_UINT32_MAX &&
@@ -1515,7 +1741,7 @@ executeAnyItem(JsonPathExecContext *cxt, JsonPathItem *jsp, JsonbContainer *jbc,
 				res = executeAnyItem
 					(cxt, jsp, v.val.binary.data, found,
 					 level + 1, first, last,
-					 ignoreStructuralErrors, unwrapNext);
+					 ignoreStructuralErrors, unwrapNext, keyFilter);
 
 				if (jperIsError(res))
 					break;
@@ -1529,6 +1755,186 @@ executeAnyItem(JsonPathExecContext *cxt, JsonPathItem *jsp, JsonbContainer *jbc,
 	return res;
 }
 
+/*
+ * Prepare skipping of the items of a .** search over 'jb' which can't produce
+ * any results, because the next item 'jsp' requires a key which they don't
+ * contain (see getRequiredKey()).
+ *
+ * Keys are stored in jsonb as is, so a container can only have the key
+ * somewhere inside if its binary representation contains the key bytes.  We
+ * find all occurrences of the key in the searched container once, and then
+ * checking any nested container comes down to a binary search.
+ */
+static bool
+initKeyFilter(JsonPathExecContext *cxt, JsonPathKeyFilter *filter,
+			  JsonPathItem *jsp, JsonbValue *jb)
+{
+	char	   *data = (char *) jb->val.binary.data;
+	char	   *end = data + jb->val.binary.len;
+	char	   *p;
+
+	Assert(jb->type == jbvBinary);
+
+	if (jb->val.binary.len < JSONPATH_KEY_FILTER_MIN_SIZE ||
+		!getRequiredKey(cxt, jsp, &filter->key, &filter->keylen) ||
+		filter->keylen == 0)
+		return false;
+
+	filter->occurrences = palloc(sizeof(char *) *
+								 JSONPATH_KEY_FILTER_MAX_OCCURRENCES);
+	filter->noccurrences = 0;
+
+	for (p = data; end - p >= filter->keylen; p++)
+	{
+		p = memchr(p, filter->key[0], end - p - filter->keylen + 1);
+
+		if (!p)
+			break;
+
+		if (memcmp(p, filter->key, filter->keylen) != 0)
+			continue;
+
+		if (filter->noccurrences >= JSONPATH_KEY_FILTER_MAX_OCCURRENCES)
+		{
+			pfree(filter->occurrences);
+			return false;
+		}
+
+		filter->occurrences[filter->noccurrences++] = p;
+	}
+
+	return true;
+}
+
+/*
+ * Can item 'jb' of a .** search, or one of its descendants, contain the key
+ * of the filter?
+ */
+static bool
+keyFilterMayMatch(JsonPathKeyFilter *filter, JsonbValue *jb)
+{
+	char	   *start;
+	int			lo = 0;
+	int			hi = filter->noccurrences;
+
+	/* Scalars have no keys */
+	if (jb->type != jbvBinary)
+		return false;
+
+	start = (char *) jb->val.binary.data;
+
+	/* Find the first occurrence of the key not before the container */
+	while (lo < hi)
+	{
+		int			mid = lo + (hi - lo) / 2;
+
+		if (filter->occurrences[mid] < start)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo < filter->noccurrences &&
+		filter->occurrences[lo] + filter->keylen <= start + jb->val.binary.len;
+}
+
+/*
+ * Find a key which an item must contain for the path 'jsp' to produce any
+ * results from it, when applied to an item found by .** accessor.  This is
+ * the case for a key accessor, and for a filter whose predicate needs the
+ * key in the current item, like "? (@.key == 1)".  Structural errors are
+ * ignored under .**, so items without the key can just be skipped.  Filters
+ * which can throw errors that are not suppressed in predicates are not
+ * considered, because skipping the items would lose the errors.
+ */
+static bool
+getRequiredKey(JsonPathExecContext *cxt, JsonPathItem *jsp,
+			   char **key, int *keylen)
+{
+	JsonPathItem arg;
+	int			flags = 0;
+	int			unsafe = JSP_COST_HAS_VARIABLES;
+
+	switch (jsp->type)
+	{
+		case jpiKey:
+			*key = jspGetString(jsp, keylen);
+			return true;
+
+		case jpiFilter:
+			if (!cxt->useTz)
+				unsafe |= JSP_COST_HAS_DATETIME;
+
+			jspGetArg(jsp, &arg);
+			(void) jspEstimateCost(&arg, &flags);
+
+			if (flags & unsafe)
+				return false;
+
+			return getPredicateRequiredKey(&arg, key, keylen);
+
+		default:
+			return false;
+	}
+}
+
+/*
+ * Find a key which the current item must contain for predicate 'pred' to be
+ * true.
+ */
+static bool
+getPredicateRequiredKey(JsonPathItem *pred, char **key, int *keylen)
+{
+	JsonPathItem arg;
+
+	switch (pred->type)
+	{
+		case jpiAnd:
+			jspGetLeftArg(pred, &arg);
+			if (getPredicateRequiredKey(&arg, key, keylen))
+				return true;
+			jspGetRightArg(pred, &arg);
+			return getPredicateRequiredKey(&arg, key, keylen);
+
+		case jpiEqual:
+		case jpiNotEqual:
+		case jpiLess:
+		case jpiGreater:
+		case jpiLessOrEqual:
+		case jpiGreaterOrEqual:
+		case jpiStartsWith:
+			/* comparisons are false if either operand is empty */
+			jspGetLeftArg(pred, &arg);
+			if (getCurrentItemKey(&arg, key, keylen))
+				return true;
+			jspGetRightArg(pred, &arg);
+			return getCurrentItemKey(&arg, key, keylen);
+
+		case jpiExists:
+			jspGetArg(pred, &arg);
+			return getCurrentItemKey(&arg, key, keylen);
+
+		default:
+			return false;
+	}
+}
+
+/*
+ * Is 'jsp' a path starting with a key accessor of the current item, "@.key"?
+ */
+static bool
+getCurrentItemKey(JsonPathItem *jsp, char **key, int *keylen)
+{
+	JsonPathItem next;
+
+	if (jsp->type != jpiCurrent || !jspGetNext(jsp, &next) ||
+		next.type != jpiKey)
+		return false;
+
+	*key = jspGetString(&next, keylen);
+	return true;
+}
+
 /*
  * Execute unary or binary predicate.
  *
@@ -1662,15 +2068,13 @@ executeBinaryArithmExpr(JsonPathExecContext *cxt, JsonPathItem *jsp,
 							  errmsg("right operand of jsonpath operator %s is not a single numeric value",
 									 jspOperationName(jsp->type)))));
 
-	if (jspThrowErrors(cxt))
-	{
-		res = func(lval->val.numeric, rval->val.numeric, NULL);
-	}
-	else
+	if (!executeIntegerArithm(jsp->type, lval->val.numeric,
+							  rval->val.numeric, &res))
 	{
 		bool		error = false;
 
-		res = func(lval->val.numeric, rval->val.numeric, &error);
+		res = func(lval->val.numeric, rval->val.numeric,
+				   jspThrowErrors(cxt) ? NULL : &error);
 
 		if (error)
 			return jperError;
@@ -1686,6 +2090,58 @@ executeBinaryArithmExpr(JsonPathExecContext *cxt, JsonPathItem *jsp,
 	return executeNextItem(cxt, jsp, &elem, lval, found, false);
 }
 
+/*
+ * Fast path of binary arithmetic for integral operands, which are the most
+ * common ones.  Computation is performed in int64, so that numeric arithmetic
+ * is skipped.  Returns false if operands are not small integers or if the
+ * result can overflow, then the caller should fall back to numeric functions.
+ * Division is not handled here because its result scale is determined by the
+ * numeric rules.
+ */
+static bool
+executeIntegerArithm(JsonPathItemType op, Numeric lnum, Numeric rnum,
+					 Numeric *res)
+{
+	int64		lval;
+	int64		rval;
+	int64		result;
+
+	if (!numeric_get_int64(lnum, &lval) ||
+		!numeric_get_int64(rnum, &rval))
+		return false;
+
+	switch (op)
+	{
+		case jpiAdd:
+			if (pg_add_s64_overflow(lval, rval, &result))
+				return false;
+			break;
+
+		case jpiSub:
+			if (pg_sub_s64_overflow(lval, rval, &result))
+				return false;
+			break;
+
+		case jpiMul:
+			if (pg_mul_s64_overflow(lval, rval, &result))
+				return false;
+			break;
+
+		case jpiMod:
+			if (rval == 0)
+				return false;	/* let numeric_mod() report an error */
+			result = lval % rval;
+			break;
+
+		default:
+			return false;
+	}
+
+	*res = int64_to_numeric(result);
+
+	return true;
+}
+
 /*
  * Execute unary arithmetic expression for each numeric item in its operand's
  * sequence.  Array operand is automatically unwrapped in lax mode.
@@ -2051,8 +2507,7 @@ executeKeyValueMethod(JsonPathExecContext *cxt, JsonPathItem *jsp,
 	id += (int64) cxt->baseObject.id * INT64CONST(10000000000);
 
 	idval.type = jbvNumeric;
-	idval.val.numeric = DatumGetNumeric(DirectFunctionCall1(int8_numeric,
-															Int64GetDatum(id)));
+	idval.val.numeric = int64_to_numeric(id);
 
 	it = JsonbIteratorInit(jbc);
 
@@ -2173,29 +2628,74 @@ getJsonPathItem(JsonPathExecContext *cxt, JsonPathItem *item,
 
 /*
  * Get the value of variable passed to jsonpath executor
+ *
+ * Variables don't change during the execution, so each variable reference is
+ * looked up by name only once and then remembered by the position of its
+ * item, which saves repeated lookups when the reference is evaluated for
+ * every item of an array, as in filters.
  */
 static void
 getJsonPathVariable(JsonPathExecContext *cxt, JsonPathItem *variable,
 					JsonbValue *value)
 {
-	char	   *varName;
-	int			varNameLength;
-	JsonbValue	baseObject;
-	int			baseObjectId;
+	int32		pos = variable->base - cxt->pathData;
+	JsonPathVarSlot *slot;
+	int			i;
 
 	Assert(variable->type == jpiVariable);
-	varName = jspGetString(variable, &varNameLength);
+	Assert(pos >= 0 && pos < cxt->pathLen);
 
-	if (!cxt->vars ||
-		(baseObjectId = cxt->getVar(cxt->vars, varName, varNameLength, value,
-									&baseObject)) < 0)
-		ereport(ERROR,
-				(errcode(ERRCODE_UNDEFINED_OBJECT),
-				 errmsg("could not find jsonpath variable \"%s\"",
-						pnstrdup(varName, varNameLength))));
+	for (i = 0; i < cxt->nvarSlots; i++)
+	{
+		if (cxt->varSlots[i].pos == pos)
+			break;
+	}
+
+	if (i < cxt->nvarSlots)
+		slot = &cxt->varSlots[i];
+	else
+	{
+		char	   *varName;
+		int			varNameLength;
+
+		varName = jspGetString(variable, &varNameLength);
+
+		if (cxt->nvarSlots >= cxt->varSlotsSize)
+		{
+			if (!cxt->varSlots)
+			{
+				cxt->varSlotsSize = 4;
+				cxt->varSlots = palloc(sizeof(JsonPathVarSlot) *
+									   cxt->varSlotsSize);
+			}
+			else
+			{
+				cxt->varSlotsSize *= 2;
+				cxt->varSlots = repalloc(cxt->varSlots,
+										 sizeof(JsonPathVarSlot) *
+										 cxt->varSlotsSize);
+			}
+		}
+
+		slot = &cxt->varSlots[cxt->nvarSlots];
+
+		if (!cxt->vars ||
+			(slot->baseObjectId = cxt->getVar(cxt->vars, varName,
+											  varNameLength, &slot->value,
+											  &slot->baseObject)) < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_OBJECT),
+					 errmsg("could not find jsonpath variable \"%s\"",
+							pnstrdup(varName, varNameLength))));
 
-	if (baseObjectId > 0)
-		setBaseObject(cxt, &baseObject, baseObjectId);
+		slot->pos = pos;
+		cxt->nvarSlots++;
+	}
+
+	*value = slot->value;
+
+	if (slot->baseObjectId > 0)
+		setBaseObject(cxt, &slot->baseObject, slot->baseObjectId);
 }
 
 static int
@@ -2455,6 +2955,13 @@ compareItems(int32 op, JsonbValue *jb1, JsonbValue *jb2, bool useTz)
 static int
 compareNumeric(Numeric a, Numeric b)
 {
+	int64		aval;
+	int64		bval;
+
+	/* Fast path for small integers */
+	if (numeric_get_int64(a, &aval) && numeric_get_int64(b, &bval))
+		return aval < bval ? -1 : aval > bval ? 1 : 0;
+
 	return DatumGetInt32(DirectFunctionCall2(numeric_cmp,
 											 NumericGetDatum(a),
 											 NumericGetDatum(b)));
@@ -2954,35 +3461,338 @@ compareDatetime(Datum val1, Oid typid1, Datum val2, Oid typid2,
 	return DatumGetInt32(DirectFunctionCall2(cmpfunc, val1, val2));
 }
 
-/********************Interface to pgsql's executor***************************/
+/*************** Streaming execution of jsonpath over json text ***************/
 
-bool
-JsonPathExists(Datum jb, JsonPath *jp, List *vars, bool *error)
+/*
+ * Try to execute jsonpath directly over json text without its conversion
+ * to jsonb.
+ *
+ * Only paths consisting of key accessors and single non-negative constant
+ * array subscripts, like '$.a[0].b', are supported.  Such a path addresses
+ * at most one item, which is located by the streaming json parser, and only
+ * this item is converted to jsonb.  Other parts of the document are only
+ * lexed.
+ *
+ * Returns false if the path is not supported or if the result depends on
+ * something the streaming evaluation does not handle: automatic unwrapping
+ * or wrapping of arrays in lax mode, or structural errors in strict mode.
+ * The caller then has to execute the path over the converted document.
+ */
+static bool
+executeJsonPathOnText(JsonPath *path, text *json, JsonValueList *result,
+					  JsonPathExecResult *res)
 {
-	JsonPathExecResult res = executeJsonPath(jp, vars, EvalJsonPathVar,
-											 DatumGetJsonbP(jb), !error, NULL,
-											 true);
+	JsonTextPathState state;
+	JsonSemAction sem;
+	JsonPathItem jsp;
+	JsonPathItem elem;
+	int			npath = 0;
 
-	Assert(error || !jperIsError(res));
+	jspInit(&jsp, path);
 
-	if (error && jperIsError(res))
-		*error = true;
+	if (jsp.type != jpiRoot || !jspGetNext(&jsp, &elem))
+		return false;
 
-	return res == jperOk;
-}
+	/* check path items and count them */
+	do
+	{
+		if (elem.type == jpiIndexArray)
+		{
+			JsonPathItem from;
+			JsonPathItem to;
+			int64		index;
+
+			if (elem.content.array.nelems != 1 ||
+				jspGetArraySubscript(&elem, &from, &to, 0) ||
+				from.type != jpiNumeric ||
+				!numeric_get_int64(jspGetNumeric(&from), &index) ||
+				index < 0 || index > PG_INT32_MAX)
+				return false;
+		}
+		else if (elem.type != jpiKey)
+			return false;
+
+		npath++;
+	} while (jspGetNext(&elem, &elem));
+
+	memset(&state, 0, sizeof(state));
+	state.npath = npath;
+	state.keys = palloc(sizeof(char *) * npath);
+	state.keylens = palloc(sizeof(int) * npath);
+	state.indexes = palloc(sizeof(int) * npath);
+	state.curindex = palloc(sizeof(int) * npath);
+	state.pathok = palloc0(sizeof(bool) * (npath + 1));
+	state.pathok[0] = true;
+	/* reset by the root container callbacks if it has the proper type */
+	state.mismatch = true;
+
+	npath = 0;
+	jspGetNext(&jsp, &elem);
+
+	do
+	{
+		if (elem.type == jpiKey)
+		{
+			int32		len;
 
-Datum
-JsonPathQuery(Datum jb, JsonPath *jp, JsonWrapper wrapper, bool *empty,
-			  bool *error, List *vars)
-{
+			state.keys[npath] = jspGetString(&elem, &len);
+			state.keylens[npath] = len;
+		}
+		else
+		{
+			JsonPathItem from;
+			JsonPathItem to;
+			int64		index;
+
+			(void) jspGetArraySubscript(&elem, &from, &to, 0);
+			(void) numeric_get_int64(jspGetNumeric(&from), &index);
+
+			state.keys[npath] = NULL;
+			state.indexes[npath] = (int) index;
+		}
+
+		npath++;
+	} while (jspGetNext(&elem, &elem));
+
+	state.lex = makeJsonLexContext(json, true);
+
+	memset(&sem, 0, sizeof(sem));
+	sem.semstate = &state;
+	sem.object_start = jsonTextPathObjectStart;
+	sem.array_start = jsonTextPathArrayStart;
+	sem.object_field_start = jsonTextPathFieldStart;
+	sem.object_field_end = jsonTextPathFieldEnd;
+	sem.array_element_start = jsonTextPathElementStart;
+	sem.array_element_end = jsonTextPathElementEnd;
+
+	pg_parse_json_or_ereport(state.lex, &sem);
+
+	if (state.mismatch)
+		return false;
+
+	if (!state.result)
+	{
+		/* missing item is a structural error in strict mode */
+		if (!(path->header & JSONPATH_LAX))
+			return false;
+
+		*res = jperNotFound;
+		return true;
+	}
+
+	if (result)
+	{
+		JsonbValue *jbv = palloc(sizeof(*jbv));
+		char	   *str = pnstrdup(state.result, state.resultlen);
+		Datum		jb = DirectFunctionCall1(jsonb_in, CStringGetDatum(str));
+
+		JsonItemFromDatum(jb, JSONBOID, -1, jbv);
+		JsonValueListAppend(result, jbv);
+	}
+
+	*res = jperOk;
+	return true;
+}
+
+static void
+jsonTextPathObjectStart(void *state)
+{
+	JsonTextPathState *_state = (JsonTextPathState *) state;
+
+	if (_state->lex->lex_level == 0)
+		_state->mismatch = _state->keys[0] == NULL;
+}
+
+static void
+jsonTextPathArrayStart(void *state)
+{
+	JsonTextPathState *_state = (JsonTextPathState *) state;
+	int			lex_level = _state->lex->lex_level;
+
+	if (lex_level < _state->npath && _state->pathok[lex_level])
+	{
+		if (lex_level == 0)
+			_state->mismatch = _state->keys[0] != NULL;
+
+		/* initialize counting of elements in this array */
+		_state->curindex[lex_level] = -1;
+	}
+}
+
+/*
+ * Handle start of the value matched by the accessor at level 'lex_level'.
+ */
+static void
+jsonTextPathMatchStart(JsonTextPathState *state, int lex_level)
+{
+	/* duplicate key supersedes the previously matched value */
+	state->result = NULL;
+
+	if (lex_level < state->npath)
+	{
+		JsonTokenType expected = state->keys[lex_level] ?
+			JSON_TOKEN_OBJECT_START : JSON_TOKEN_ARRAY_START;
+
+		if (state->lex->token_type != expected)
+			state->mismatch = true;
+
+		state->pathok[lex_level] = true;
+	}
+	else
+		state->result_start = state->lex->token_start;
+}
+
+/*
+ * Handle end of the value matched by the accessor at level 'lex_level'.
+ */
+static void
+jsonTextPathMatchEnd(JsonTextPathState *state, int lex_level)
+{
+	if (lex_level < state->npath)
+		state->pathok[lex_level] = false;
+	else
+	{
+		state->result = state->result_start;
+		state->resultlen = state->lex->prev_token_terminator -
+			state->result_start;
+	}
+}
+
+static bool
+jsonTextPathKeyMatches(JsonTextPathState *state, char *fname)
+{
+	int			lex_level = state->lex->lex_level;
+
+	return lex_level <= state->npath &&
+		state->pathok[lex_level - 1] &&
+		state->keys[lex_level - 1] != NULL &&
+		strlen(fname) == state->keylens[lex_level - 1] &&
+		memcmp(fname, state->keys[lex_level - 1],
+			   state->keylens[lex_level - 1]) == 0;
+}
+
+static void
+jsonTextPathFieldStart(void *state, char *fname, bool isnull)
+{
+	JsonTextPathState *_state = (JsonTextPathState *) state;
+
+	if (jsonTextPathKeyMatches(_state, fname))
+		jsonTextPathMatchStart(_state, _state->lex->lex_level);
+}
+
+static void
+jsonTextPathFieldEnd(void *state, char *fname, bool isnull)
+{
+	JsonTextPathState *_state = (JsonTextPathState *) state;
+
+	if (jsonTextPathKeyMatches(_state, fname))
+		jsonTextPathMatchEnd(_state, _state->lex->lex_level);
+}
+
+static void
+jsonTextPathElementStart(void *state, bool isnull)
+{
+	JsonTextPathState *_state = (JsonTextPathState *) state;
+	int			lex_level = _state->lex->lex_level;
+
+	if (lex_level <= _state->npath &&
+		_state->pathok[lex_level - 1] &&
+		_state->keys[lex_level - 1] == NULL &&
+		++_state->curindex[lex_level - 1] == _state->indexes[lex_level - 1])
+		jsonTextPathMatchStart(_state, lex_level);
+}
+
+static void
+jsonTextPathElementEnd(void *state, bool isnull)
+{
+	JsonTextPathState *_state = (JsonTextPathState *) state;
+	int			lex_level = _state->lex->lex_level;
+
+	if (lex_level <= _state->npath &&
+		_state->pathok[lex_level - 1] &&
+		_state->keys[lex_level - 1] == NULL &&
+		_state->curindex[lex_level - 1] == _state->indexes[lex_level - 1])
+		jsonTextPathMatchEnd(_state, lex_level);
+}
+
+/*
+ * Execute jsonpath over SQL/JSON context item of json or jsonb type.
+ */
+static JsonPathExecResult
+executeJsonPathForItem(JsonPath *path, List *vars, Datum item, Oid typid,
+					   bool throwErrors, JsonValueList *result)
+{
+	Jsonb	   *jb;
+
+	if (typid == JSONOID)
+	{
+		text	   *json = DatumGetTextP(item);
+		JsonPathExecResult res;
+		char	   *str;
+
+		if (executeJsonPathOnText(path, json, result, &res))
+			return res;
+
+		str = text_to_cstring(json);
+		jb = DatumGetJsonbP(DirectFunctionCall1(jsonb_in,
+												CStringGetDatum(str)));
+		pfree(str);
+	}
+	else
+		jb = DatumGetJsonbP(item);
+
+	return executeJsonPath(path, vars, EvalJsonPathVar, jb, throwErrors,
+						   result, true);
+}
+
+/********************Interface to pgsql's executor***************************/
+
+bool
+JsonPathExists(Datum jb, Oid typid, JsonPath *jp, List *vars, bool *error)
+{
+	JsonPathExecResult res = executeJsonPathForItem(jp, vars, jb, typid,
+													!error, NULL);
+
+	Assert(error || !jperIsError(res));
+
+	if (error && jperIsError(res))
+		*error = true;
+
+	return res == jperOk;
+}
+
+/*
+ * Should the items found by JSON_QUERY be wrapped into an array?
+ */
+static bool
+JsonPathQueryNeedsWrapper(JsonbValue *first, int count, JsonWrapper wrapper)
+{
+	if (!first)
+		return false;
+	else if (wrapper == JSW_NONE)
+		return false;
+	else if (wrapper == JSW_UNCONDITIONAL)
+		return true;
+	else if (wrapper == JSW_CONDITIONAL)
+		return count > 1 ||
+			IsAJsonbScalar(first) ||
+			(first->type == jbvBinary &&
+			 JsonContainerIsScalar(first->val.binary.data));
+
+	elog(ERROR, "unrecognized json wrapper %d", wrapper);
+	return false;
+}
+
+Datum
+JsonPathQuery(Datum jb, Oid typid, JsonPath *jp, JsonWrapper wrapper,
+			  bool *empty, bool *error, List *vars)
+{
 	JsonbValue *first;
-	bool		wrap;
 	JsonValueList found = {0};
 	JsonPathExecResult res PG_USED_FOR_ASSERTS_ONLY;
 	int			count;
 
-	res = executeJsonPath(jp, vars, EvalJsonPathVar, DatumGetJsonbP(jb), !error,
-						  &found, true);
+	res = executeJsonPathForItem(jp, vars, jb, typid, !error, &found);
 
 	Assert(error || !jperIsError(res));
 
@@ -2997,24 +3807,7 @@ JsonPathQuery(Datum jb, JsonPath *jp, JsonWrapper wrapper, bool *empty,
 
 	first = count ? JsonValueListHead(&found) : NULL;
 
-	if (!first)
-		wrap = false;
-	else if (wrapper == JSW_NONE)
-		wrap = false;
-	else if (wrapper == JSW_UNCONDITIONAL)
-		wrap = true;
-	else if (wrapper == JSW_CONDITIONAL)
-		wrap = count > 1 ||
-			IsAJsonbScalar(first) ||
-			(first->type == jbvBinary &&
-			 JsonContainerIsScalar(first->val.binary.data));
-	else
-	{
-		elog(ERROR, "unrecognized json wrapper %d", wrapper);
-		wrap = false;
-	}
-
-	if (wrap)
+	if (JsonPathQueryNeedsWrapper(first, count, wrapper))
 		return JsonbPGetDatum(JsonbValueToJsonb(wrapItemsInArray(&found)));
 
 	if (count > 1)
@@ -3040,16 +3833,35 @@ JsonPathQuery(Datum jb, JsonPath *jp, JsonWrapper wrapper, bool *empty,
 	return PointerGetDatum(NULL);
 }
 
+/*
+ * Same as JsonPathQuery(), but for the single item already found by the
+ * caller.
+ */
+Datum
+JsonItemQuery(JsonbValue *item, JsonWrapper wrapper)
+{
+	if (JsonPathQueryNeedsWrapper(item, 1, wrapper))
+	{
+		JsonValueList found = {0};
+
+		JsonValueListAppend(&found, item);
+
+		return JsonbPGetDatum(JsonbValueToJsonb(wrapItemsInArray(&found)));
+	}
+
+	return JsonbPGetDatum(JsonbValueToJsonb(item));
+}
+
 JsonbValue *
-JsonPathValue(Datum jb, JsonPath *jp, bool *empty, bool *error, List *vars)
+JsonPathValue(Datum jb, Oid typid, JsonPath *jp, bool *empty, bool *error,
+			  List *vars)
 {
 	JsonbValue   *res;
 	JsonValueList found = { 0 };
 	JsonPathExecResult jper PG_USED_FOR_ASSERTS_ONLY;
 	int			count;
 
-	jper = executeJsonPath(jp, vars, EvalJsonPathVar, DatumGetJsonbP(jb), !error,
-						   &found, true);
+	jper = executeJsonPathForItem(jp, vars, jb, typid, !error, &found);
 
 	Assert(error || !jperIsError(jper));
 
@@ -3083,11 +3895,21 @@ JsonPathValue(Datum jb, JsonPath *jp, bool *empty, bool *error, List *vars)
 
 	res = JsonValueListHead(&found);
 
-	if (res->type == jbvBinary &&
-		JsonContainerIsScalar(res->val.binary.data))
-		JsonbExtractScalar(res->val.binary.data, res);
+	return JsonItemValue(res, error);
+}
+
+/*
+ * Same as JsonPathValue(), but for the single item already found by the
+ * caller.  Scalar items wrapped into a container are extracted in place.
+ */
+JsonbValue *
+JsonItemValue(JsonbValue *item, bool *error)
+{
+	if (item->type == jbvBinary &&
+		JsonContainerIsScalar(item->val.binary.data))
+		JsonbExtractScalar(item->val.binary.data, item);
 
-	if (!IsAJsonbScalar(res))
+	if (!IsAJsonbScalar(item))
 	{
 		if (error)
 		{
@@ -3101,10 +3923,10 @@ JsonPathValue(Datum jb, JsonPath *jp, bool *empty, bool *error, List *vars)
 						"singleton scalar item")));
 	}
 
-	if (res->type == jbvNull)
+	if (item->type == jbvNull)
 		return NULL;
 
-	return res;
+	return item;
 }
 
 static void
@@ -3215,6 +4037,135 @@ GetJsonTableContext(TableFuncScanState *state, const char *fname)
 	return result;
 }
 
+/*
+ * Check whether a JSON_TABLE column is JSON_VALUE(), JSON_QUERY() or
+ * JSON_EXISTS() with the path '$.key' applied to the row item, and return
+ * the key.  Such columns are extracted in a single pass over the row item by
+ * JsonTableExtractColumns(), instead of executing their paths one by one.
+ */
+static bool
+JsonTableGetColumnKey(Expr *expr, char **key, int *keylen)
+{
+	JsonExpr   *jexpr;
+	Const	   *pathspec;
+	JsonPathItem jsp;
+	JsonPathItem next;
+	int32		len;
+
+	if (!expr || !IsA(expr, JsonExpr))
+		return false;
+
+	jexpr = (JsonExpr *) expr;
+
+	if (jexpr->op == IS_JSON_TABLE ||
+		jexpr->passing_values ||
+		!IsA(jexpr->formatted_expr, CaseTestExpr) ||
+		!IsA(jexpr->path_spec, Const))
+		return false;
+
+	pathspec = (Const *) jexpr->path_spec;
+
+	if (pathspec->constisnull)
+		return false;
+
+	jspInit(&jsp, DatumGetJsonPathP(pathspec->constvalue));
+
+	if (jsp.type != jpiRoot ||
+		!jspGetNext(&jsp, &next) ||
+		next.type != jpiKey ||
+		jspHasNext(&next))
+		return false;
+
+	*key = jspGetString(&next, &len);
+	*keylen = len;
+
+	return true;
+}
+
+/*
+ * Compare keys of JSON_TABLE columns in the order of jsonb object keys: by
+ * length first, and then bytewise.
+ */
+static int
+JsonTableCompareKeys(const char *key1, int len1, const char *key2, int len2)
+{
+	if (len1 != len2)
+		return len1 > len2 ? 1 : -1;
+
+	return memcmp(key1, key2, len1);
+}
+
+/* qsort comparator for JsonTableSimpleColumn */
+static int
+JsonTableCompareColumns(const void *a, const void *b)
+{
+	const JsonTableSimpleColumn *col1 = a;
+	const JsonTableSimpleColumn *col2 = b;
+
+	return JsonTableCompareKeys(col1->key, col1->keylen,
+								col2->key, col2->keylen);
+}
+
+/*
+ * Extract the items of all the simple columns of a scan from its current
+ * row item.  Both the keys of a jsonb object and the columns are sorted, so
+ * this is a single merge pass over the object.  The columns whose keys are
+ * not found, or whose row item is not an object, execute their paths.
+ */
+static void
+JsonTableExtractColumns(JsonTableContext *cxt, JsonTableScanState *scan)
+{
+	Jsonb	   *js = DatumGetJsonbP(scan->current);
+	JsonbIterator *it;
+	JsonbIteratorToken tok PG_USED_FOR_ASSERTS_ONLY;
+	JsonbValue	key;
+	JsonbValue	val;
+	int			i;
+
+	for (i = 0; i < scan->nsimpleColumns; i++)
+		cxt->colexprs[scan->simpleColumns[i].colnum].item = NULL;
+
+	scan->columnsExtracted = true;
+
+	if (!JB_ROOT_IS_OBJECT(js))
+		return;
+
+	it = JsonbIteratorInit(&js->root);
+
+	tok = JsonbIteratorNext(&it, &key, true);
+	Assert(tok == WJB_BEGIN_OBJECT);
+
+	i = 0;
+
+	while (i < scan->nsimpleColumns &&
+		   JsonbIteratorNext(&it, &key, true) == WJB_KEY)
+	{
+		tok = JsonbIteratorNext(&it, &val, true);
+		Assert(tok == WJB_VALUE);
+
+		/* skip the columns whose keys precede the current one */
+		while (i < scan->nsimpleColumns &&
+			   JsonTableCompareKeys(scan->simpleColumns[i].key,
+									scan->simpleColumns[i].keylen,
+									key.val.string.val,
+									key.val.string.len) < 0)
+			i++;
+
+		/* the same key can be used by several columns */
+		while (i < scan->nsimpleColumns &&
+			   JsonTableCompareKeys(scan->simpleColumns[i].key,
+									scan->simpleColumns[i].keylen,
+									key.val.string.val,
+									key.val.string.len) == 0)
+		{
+			int			colnum = scan->simpleColumns[i++].colnum;
+
+			cxt->colexprs[colnum].itembuf = val;
+			cxt->colexprs[colnum].item = &cxt->colexprs[colnum].itembuf;
+		}
+	}
+}
+
 /* Recursively initialize JSON_TABLE scan state */
 static void
 JsonTableInitScanState(JsonTableContext *cxt, JsonTableScanState *scan,
@@ -3228,8 +4179,7 @@ JsonTableInitScanState(JsonTableContext *cxt, JsonTableScanState *scan,
 	scan->errorOnError = node->errorOnError;
 	scan->path = DatumGetJsonPathP(node->path->constvalue);
 	scan->args = args;
-	scan->mcxt = AllocSetContextCreate(mcxt, "JsonTableContext",
-									   ALLOCSET_DEFAULT_SIZES);
+	scan->mcxt = mcxt;
 	scan->nested = node->child ?
 		JsonTableInitPlanState(cxt, node->child, scan) : NULL;
 	scan->current = PointerGetDatum(NULL);
@@ -3260,6 +4210,7 @@ JsonTableInitPlanState(JsonTableContext *cxt, Node *plan,
 		JsonTableParentNode *node = castNode(JsonTableParentNode, plan);
 
 		state->is_join = false;
+		state->u.scan.childno = parent->nchildren++;
 
 		JsonTableInitScanState(cxt, &state->u.scan, node, parent,
 							   parent->args, parent->mcxt);
@@ -3317,23 +4268,69 @@ JsonTableInitOpaque(TableFuncScanState *state, int natts)
 	cxt->colexprs = palloc(sizeof(*cxt->colexprs) *
 						   list_length(tf->colvalexprs));
 
+	cxt->doccxt = AllocSetContextCreate(CurrentMemoryContext,
+										"JsonTableContext",
+										ALLOCSET_DEFAULT_SIZES);
+
 	JsonTableInitScanState(cxt, &cxt->root, root, NULL, args,
-						   CurrentMemoryContext);
+						   AllocSetContextCreate(CurrentMemoryContext,
+												 "JsonTableRowContext",
+												 ALLOCSET_DEFAULT_SIZES));
+
+	/* in a parallel scan, the items of the root path are divided */
+	cxt->root.pstate = state->pstate;
 
 	i = 0;
 
 	foreach(lc, tf->colvalexprs)
 	{
 		Expr	   *expr = lfirst(lc);
+		JsonTableScanState *scan = cxt->colexprs[i].scan;
+		JsonTableSimpleColumn *col;
+		char	   *key;
+		int			keylen;
+
+		cxt->colexprs[i].item = NULL;
+
+		if (!JsonTableGetColumnKey(expr, &key, &keylen))
+		{
+			cxt->colexprs[i].expr =
+				ExecInitExprWithCaseValue(expr, ps,
+										  &scan->current,
+										  &scan->currentIsNull);
+			i++;
+			continue;
+		}
 
 		cxt->colexprs[i].expr =
-			ExecInitExprWithCaseValue(expr, ps,
-									  &cxt->colexprs[i].scan->current,
-									  &cxt->colexprs[i].scan->currentIsNull);
+			ExecInitJsonExprWithItem(castNode(JsonExpr, expr), ps,
+									 &scan->current, &scan->currentIsNull,
+									 &cxt->colexprs[i].item);
+
+		if (!scan->simpleColumns)
+			scan->simpleColumns =
+				palloc(sizeof(*scan->simpleColumns) *
+					   list_length(tf->colvalexprs));
+
+		col = &scan->simpleColumns[scan->nsimpleColumns++];
+		col->key = key;
+		col->keylen = keylen;
+		col->colnum = i;
 
 		i++;
 	}
 
+	/* the columns of a scan are contiguous, sort each scan's ones once */
+	for (i = 0; i < list_length(tf->colvalexprs); i++)
+	{
+		JsonTableScanState *scan = cxt->colexprs[i].scan;
+
+		if (scan->nsimpleColumns > 1 &&
+			(i == 0 || cxt->colexprs[i - 1].scan != scan))
+			qsort(scan->simpleColumns, scan->nsimpleColumns,
+				  sizeof(*scan->simpleColumns), JsonTableCompareColumns);
+	}
+
 	state->opaque = cxt;
 }
 
@@ -3341,41 +4338,147 @@ JsonTableInitOpaque(TableFuncScanState *state, int natts)
 static void
 JsonTableRescan(JsonTableScanState *scan)
 {
-	JsonValueListInitIterator(&scan->found, &scan->iter);
+	if (scan->list)
+		JsonValueListInitIterator(&scan->list->found, &scan->iter);
+	scan->item = NULL;
 	scan->current = PointerGetDatum(NULL);
 	scan->currentIsNull = true;
 	scan->advanceNested = false;
 	scan->ordinal = 0;
+	scan->chunkEnd = 0;
+	scan->columnsExtracted = false;
 }
 
-/* Reset context item of a scan, execute JSON path and reset a scan */
-static void
-JsonTableResetContextItem(JsonTableScanState *scan, Datum item)
+/*
+ * Fetch the next item of a scan.
+ *
+ * In a parallel scan, the items of the root path are claimed by the
+ * processes in chunks, and each process skips the items claimed by others.
+ * scan->ordinal counts the items skipped too, so it stays the same as in a
+ * serial scan.
+ */
+static JsonbValue *
+JsonTableNextItem(JsonTableScanState *scan)
+{
+	if (!scan->list)
+		return NULL;
+
+	if (scan->pstate && scan->ordinal >= scan->chunkEnd)
+	{
+		int			start;
+
+		start = pg_atomic_fetch_add_u32(&scan->pstate->next_item,
+										JSON_TABLE_PARALLEL_CHUNK_SIZE);
+
+		for (; scan->ordinal < start; scan->ordinal++)
+		{
+			if (!JsonValueListNext(&scan->list->found, &scan->iter))
+				return NULL;
+		}
+
+		scan->chunkEnd = start + JSON_TABLE_PARALLEL_CHUNK_SIZE;
+	}
+
+	return JsonValueListNext(&scan->list->found, &scan->iter);
+}
+
+/* Execute JSON path of a scan for the given item */
+static JsonTableItemList *
+JsonTableExecutePath(JsonTableScanState *scan, Datum item, MemoryContext mcxt)
 {
 	MemoryContext oldcxt;
 	JsonPathExecResult res;
+	JsonTableItemList *list;
 	Jsonb		*js = (Jsonb *) DatumGetJsonbP(item);
 
-	JsonValueListClear(&scan->found);
+	oldcxt = MemoryContextSwitchTo(mcxt);
 
-	MemoryContextResetOnly(scan->mcxt);
-
-	oldcxt = MemoryContextSwitchTo(scan->mcxt);
+	list = palloc0(sizeof(*list));
 
 	res = executeJsonPath(scan->path, scan->args, EvalJsonPathVar, js,
-						  scan->errorOnError, &scan->found, false /* FIXME */);
+						  scan->errorOnError, &list->found, false /* FIXME */);
 
 	MemoryContextSwitchTo(oldcxt);
 
 	if (jperIsError(res))
 	{
 		Assert(!scan->errorOnError);
-		JsonValueListClear(&scan->found);	/* EMPTY ON ERROR case */
+		JsonValueListClear(&list->found);	/* EMPTY ON ERROR case */
 	}
 
+	return list;
+}
+
+/*
+ * Reset a nested scan for the current item of its parent.
+ *
+ * The items of nested scans are memoized in the item of the parent, so when
+ * the parent item is visited again, e.g. by the right side of a cross join
+ * of siblings for each row of the left side, its nested paths are not
+ * executed again.  Everything below the current root item is kept until the
+ * root scan moves to the next item.
+ */
+static void
+JsonTableResetNestedScan(JsonTableScanState *scan)
+{
+	JsonTableScanState *parent = scan->parent;
+	JsonTableScanItem *pitem = parent->item;
+
+	Assert(pitem);
+
+	if (!pitem->nested)
+		pitem->nested = MemoryContextAllocZero(scan->mcxt,
+											   sizeof(*pitem->nested) *
+											   parent->nchildren);
+
+	if (!pitem->nested[scan->childno])
+		pitem->nested[scan->childno] =
+			JsonTableExecutePath(scan, parent->current, scan->mcxt);
+
+	scan->list = pitem->nested[scan->childno];
+
 	JsonTableRescan(scan);
 }
 
+/* Set the current item of a scan, reusing its jsonb value if possible */
+static void
+JsonTableSetCurrentItem(JsonTableScanState *scan, JsonbValue *jbv)
+{
+	JsonTableScanItem *item;
+
+	if (!scan->parent)
+	{
+		/* root items are never visited again */
+		MemoryContextReset(scan->mcxt);
+		item = &scan->rootItem;
+		item->value = (Datum) 0;
+		item->nested = NULL;
+	}
+	else
+	{
+		JsonTableItemList *list = scan->list;
+
+		if (!list->items)
+			list->items =
+				MemoryContextAllocZero(scan->mcxt, sizeof(*list->items) *
+									   JsonValueListLength(&list->found));
+
+		item = &list->items[scan->ordinal - 1];
+	}
+
+	if (!item->value)
+	{
+		MemoryContext oldcxt = MemoryContextSwitchTo(scan->mcxt);
+
+		item->value = JsonbPGetDatum(JsonbValueToJsonb(jbv));
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	scan->item = item;
+	scan->current = item->value;
+	scan->currentIsNull = false;
+}
+
 /*
  * JsonTableSetDocument
  *		Install the input document
@@ -3385,7 +4488,12 @@ JsonTableSetDocument(TableFuncScanState *state, Datum value)
 {
 	JsonTableContext *cxt = GetJsonTableContext(state, "JsonTableSetDocument");
 
-	JsonTableResetContextItem(&cxt->root, value);
+	MemoryContextReset(cxt->root.mcxt);
+	MemoryContextReset(cxt->doccxt);
+
+	cxt->root.list = JsonTableExecutePath(&cxt->root, value, cxt->doccxt);
+
+	JsonTableRescan(&cxt->root);
 }
 
 /* Recursively reset scan and its child nodes */
@@ -3475,6 +4583,7 @@ JsonTableJoinReset(JsonTableJoinState *state)
 	{
 		state->u.scan.reset = true;
 		state->u.scan.advanceNested = false;
+		state->u.scan.list = NULL;	/* it belongs to the previous parent item */
 
 		if (state->u.scan.nested)
 			JsonTableJoinReset(state->u.scan.nested);
@@ -3493,7 +4602,7 @@ JsonTableNextRow(JsonTableScanState *scan)
 	if (scan->reset)
 	{
 		Assert(!scan->parent->currentIsNull);
-		JsonTableResetContextItem(scan, scan->parent->current);
+		JsonTableResetNestedScan(scan);
 		scan->reset = false;
 	}
 
@@ -3509,8 +4618,9 @@ JsonTableNextRow(JsonTableScanState *scan)
 	for (;;)
 	{
 		/* fetch next row */
-		JsonbValue *jbv = JsonValueListNext(&scan->found, &scan->iter);
-		MemoryContext oldcxt;
+		JsonbValue *jbv = JsonTableNextItem(scan);
+
+		scan->columnsExtracted = false;
 
 		if (!jbv)
 		{
@@ -3520,12 +4630,8 @@ JsonTableNextRow(JsonTableScanState *scan)
 		}
 
 		/* set current row item */
-		oldcxt = MemoryContextSwitchTo(scan->mcxt);
-		scan->current = JsonbPGetDatum(JsonbValueToJsonb(jbv));
-		scan->currentIsNull = false;
-		MemoryContextSwitchTo(oldcxt);
-
 		scan->ordinal++;
+		JsonTableSetCurrentItem(scan, jbv);
 
 		if (!scan->nested)
 			break;
@@ -3583,6 +4689,9 @@ JsonTableGetValue(TableFuncScanState *state, int colnum,
 	}
 	else if (estate)	/* regular column */
 	{
+		if (scan->nsimpleColumns > 0 && !scan->columnsExtracted)
+			JsonTableExtractColumns(cxt, scan);
+
 		result = ExecEvalExpr(estate, econtext, isnull);
 	}
 	else
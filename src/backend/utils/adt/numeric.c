@@ -4170,10 +4170,15 @@ numericvar_to_int32(const NumericVar *var, int32 *result)
 	return ((int64) *result == val);
 }
 
-Datum
-int8_numeric(PG_FUNCTION_ARGS)
+/*
+ * int64_to_numeric() -
+ *
+ *	Internal version of int8_numeric() for callers that work with int64
+ *	values directly.
+ */
+Numeric
+int64_to_numeric(int64 val)
 {
-	int64		val = PG_GETARG_INT64(0);
 	Numeric		res;
 	NumericVar	result;
 
@@ -4185,7 +4190,15 @@ int8_numeric(PG_FUNCTION_ARGS)
 
 	free_var(&result);
 
-	PG_RETURN_NUMERIC(res);
+	return res;
+}
+
+Datum
+int8_numeric(PG_FUNCTION_ARGS)
+{
+	int64		val = PG_GETARG_INT64(0);
+
+	PG_RETURN_NUMERIC(int64_to_numeric(val));
 }
 
 
@@ -4219,6 +4232,139 @@ numeric_int8(PG_FUNCTION_ARGS)
 	PG_RETURN_INT64(result);
 }
 
+/*
+ * numeric_get_int64() -
+ *
+ *	Cheap extraction of a small integral value.  Returns true and sets
+ *	*result if num is a finite number with zero display scale and at most
+ *	16 decimal digits, otherwise returns false.  Unlike numeric_int8(), the
+ *	value is not rounded and nothing is allocated, so callers can use this
+ *	as a fast path and fall back to numeric arithmetic on false.
+ */
+bool
+numeric_get_int64(Numeric num, int64 *result)
+{
+	NumericDigit *digits;
+	int			ndigits;
+	int			weight;
+	int			i;
+	int64		val = 0;
+
+	if (NUMERIC_IS_SPECIAL(num) || NUMERIC_DSCALE(num) != 0)
+		return false;
+
+	ndigits = NUMERIC_NDIGITS(num);
+
+	if (ndigits == 0)
+	{
+		*result = 0;
+		return true;
+	}
+
+	/*
+	 * Values having no more than 16 decimal digits can be accumulated and
+	 * then negated without any overflow checks.
+	 */
+	weight = NUMERIC_WEIGHT(num);
+
+	if (weight < 0 || (weight + 1) * DEC_DIGITS > 16 || ndigits > weight + 1)
+		return false;
+
+	digits = NUMERIC_DIGITS(num);
+
+	for (i = 0; i <= weight; i++)
+	{
+		val *= NBASE;
+
+		if (i < ndigits)
+			val += digits[i];
+	}
+
+	*result = NUMERIC_SIGN(num) == NUMERIC_NEG ? -val : val;
+
+	return true;
+}
+
+/*
+ * numeric_is_canonical() -
+ *
+ *	Is num stored in the canonical representation of its value, as produced
+ *	by make_result() for the smallest display scale that represents the value
+ *	exactly?  Equal values for which this holds have identical binary
+ *	representations.  NaN and infinities have no scale, so they qualify.
+ */
+bool
+numeric_is_canonical(Numeric num)
+{
+	NumericVar	var;
+
+	if (NUMERIC_IS_SPECIAL(num))
+		return true;
+
+	init_var_from_num(num, &var);
+
+	/* make_result() strips leading and trailing zero digits */
+	if (var.ndigits > 0 &&
+		(var.digits[0] == 0 || var.digits[var.ndigits - 1] == 0))
+		return false;
+
+	/* ... stores zero as positive with zero weight */
+	if (var.ndigits == 0 && (var.sign != NUMERIC_POS || var.weight != 0))
+		return false;
+
+	/* ... and uses the short format whenever possible */
+	if (!NUMERIC_IS_SHORT(num) &&
+		NUMERIC_CAN_BE_SHORT(var.dscale, var.weight))
+		return false;
+
+	return get_min_scale(&var) == var.dscale;
+}
+
+/*
+ * numeric_sort_prefix() -
+ *
+ *	Order-preserving summary of a numeric value for abbreviated keys of
+ *	types containing numerics: if a < b, then the prefix of a is less than
+ *	or equal to the prefix of b.  The prefix is built from the sign, the
+ *	weight and the first NBASE digit, and is always within
+ *	+/- NUMERIC_SORT_PREFIX_MAX.
+ */
+int32
+numeric_sort_prefix(Numeric num)
+{
+	int			weight;
+	int32		result;
+
+	if (NUMERIC_IS_SPECIAL(num))
+	{
+		if (NUMERIC_IS_NINF(num))
+			return -NUMERIC_SORT_PREFIX_MAX;
+		else if (NUMERIC_IS_PINF(num))
+			return NUMERIC_SORT_PREFIX_MAX - 1;
+		else					/* NaN sorts after everything else */
+			return NUMERIC_SORT_PREFIX_MAX;
+	}
+
+	if (NUMERIC_NDIGITS(num) == 0)
+		return 0;
+
+	/*
+	 * Weights within +/- 510 are stored with the first digit.  Larger and
+	 * smaller weights get a bucket of their own above or below all of them;
+	 * the first digit must be left out there, since values of different
+	 * weights share the bucket.
+	 */
+	weight = NUMERIC_WEIGHT(num);
+	if (weight > 510)
+		result = 1 + (1022 << 14);
+	else if (weight < -510)
+		result = 1;
+	else
+		result = 1 + (((weight + 511) << 14) | NUMERIC_DIGITS(num)[0]);
+
+	return NUMERIC_SIGN(num) == NUMERIC_NEG ? -result : result;
+}
+
 
 Datum
 int2_numeric(PG_FUNCTION_ARGS)
@@ -203,6 +203,8 @@ pg_parse_json(JsonLexContext *lex, JsonSemAction *sem)
 
 	if (result == JSON_SUCCESS)
 		result = lex_expect(JSON_PARSE_END, lex, JSON_TOKEN_END);
+	else if (result == JSON_SEM_ACTION_STOPPED)
+		result = JSON_SUCCESS;
 
 	return result;
 }
@@ -309,6 +311,8 @@ parse_scalar(JsonLexContext *lex, JsonSemAction *sem)
 
 	/* invoke the callback */
 	(*sfunc) (sem->semstate, val, tok);
+	if (lex->stop_parsing)
+		return JSON_SEM_ACTION_STOPPED;
 
 	return JSON_SUCCESS;
 }
@@ -345,7 +349,11 @@ parse_object_field(JsonLexContext *lex, JsonSemAction *sem)
 	isnull = tok == JSON_TOKEN_NULL;
 
 	if (ostart != NULL)
+	{
 		(*ostart) (sem->semstate, fname, isnull);
+		if (lex->stop_parsing)
+			return JSON_SEM_ACTION_STOPPED;
+	}
 
 	switch (tok)
 	{
@@ -362,7 +370,11 @@ parse_object_field(JsonLexContext *lex, JsonSemAction *sem)
 		return result;
 
 	if (oend != NULL)
+	{
 		(*oend) (sem->semstate, fname, isnull);
+		if (lex->stop_parsing)
+			return JSON_SEM_ACTION_STOPPED;
+	}
 	return JSON_SUCCESS;
 }
 
@@ -381,7 +393,11 @@ parse_object(JsonLexContext *lex, JsonSemAction *sem)
 	check_stack_depth();
 
 	if (ostart != NULL)
+	{
 		(*ostart) (sem->semstate);
+		if (lex->stop_parsing)
+			return JSON_SEM_ACTION_STOPPED;
+	}
 
 	/*
 	 * Data inside an object is at a higher nesting level than the object
@@ -425,7 +441,11 @@ parse_object(JsonLexContext *lex, JsonSemAction *sem)
 	lex->lex_level--;
 
 	if (oend != NULL)
+	{
 		(*oend) (sem->semstate);
+		if (lex->stop_parsing)
+			return JSON_SEM_ACTION_STOPPED;
+	}
 
 	return JSON_SUCCESS;
 }
@@ -443,7 +463,11 @@ parse_array_element(JsonLexContext *lex, JsonSemAction *sem)
 	isnull = tok == JSON_TOKEN_NULL;
 
 	if (astart != NULL)
+	{
 		(*astart) (sem->semstate, isnull);
+		if (lex->stop_parsing)
+			return JSON_SEM_ACTION_STOPPED;
+	}
 
 	/* an array element is any object, array or scalar */
 	switch (tok)
@@ -462,7 +486,11 @@ parse_array_element(JsonLexContext *lex, JsonSemAction *sem)
 		return result;
 
 	if (aend != NULL)
+	{
 		(*aend) (sem->semstate, isnull);
+		if (lex->stop_parsing)
+			return JSON_SEM_ACTION_STOPPED;
+	}
 
 	return JSON_SUCCESS;
 }
@@ -481,7 +509,11 @@ parse_array(JsonLexContext *lex, JsonSemAction *sem)
 	check_stack_depth();
 
 	if (astart != NULL)
+	{
 		(*astart) (sem->semstate);
+		if (lex->stop_parsing)
+			return JSON_SEM_ACTION_STOPPED;
+	}
 
 	/*
 	 * Data inside an array is at a higher nesting level than the array
@@ -514,7 +546,11 @@ parse_array(JsonLexContext *lex, JsonSemAction *sem)
 	lex->lex_level--;
 
 	if (aend != NULL)
+	{
 		(*aend) (sem->semstate);
+		if (lex->stop_parsing)
+			return JSON_SEM_ACTION_STOPPED;
+	}
 
 	return JSON_SUCCESS;
 }
@@ -1058,6 +1094,7 @@ json_errdetail(JsonParseErrorType error, JsonLexContext *lex)
 	switch (error)
 	{
 		case JSON_SUCCESS:
+		case JSON_SEM_ACTION_STOPPED:
 			/* fall through to the error code after switch */
 			break;
 		case JSON_ESCAPING_INVALID:
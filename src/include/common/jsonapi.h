@@ -52,7 +52,8 @@ typedef enum
 	JSON_UNICODE_ESCAPE_FORMAT,
 	JSON_UNICODE_HIGH_ESCAPE,
 	JSON_UNICODE_HIGH_SURROGATE,
-	JSON_UNICODE_LOW_SURROGATE
+	JSON_UNICODE_LOW_SURROGATE,
+	JSON_SEM_ACTION_STOPPED
 } JsonParseErrorType;
 
 
@@ -68,6 +69,11 @@ typedef enum
  * token_terminator and prev_token_terminator point to the character
  * AFTER the end of the token, i.e. where there would be a nul byte
  * if we were using nul-terminated strings.
+ *
+ * The exception is stop_parsing, which a semantic action can set to make
+ * pg_parse_json return successfully right after the action, without looking
+ * at the rest of the input.  This is only useful when the input is already
+ * known to be valid.
  */
 typedef struct JsonLexContext
 {
@@ -82,6 +88,7 @@ typedef struct JsonLexContext
 	int			line_number;
 	char	   *line_start;
 	StringInfo	strval;
+	bool		stop_parsing;
 } JsonLexContext;
 
 typedef void (*json_struct_action) (void *state);
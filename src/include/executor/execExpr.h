@@ -690,6 +690,9 @@ typedef struct ExprEvalStep
 
 			void	   *cache;				/* cache for json_populate_type() */
 
+			struct JsonbValue **item;		/* item found by the caller
+											 * instead of the path, or NULL */
+
 			struct JsonCoercionsState
 			{
 				struct JsonCoercionState
@@ -249,10 +249,15 @@ ExecProcNode(PlanState *node)
 /*
  * prototypes from functions in execExpr.c
  */
+struct JsonbValue;				/* avoid including jsonb.h here */
+
 extern ExprState *ExecInitExpr(Expr *node, PlanState *parent);
 extern ExprState *ExecInitExprWithParams(Expr *node, ParamListInfo ext_params);
 extern ExprState *ExecInitExprWithCaseValue(Expr *node, PlanState *parent,
 						  Datum *caseval, bool *casenull);
+extern ExprState *ExecInitJsonExprWithItem(JsonExpr *jexpr, PlanState *parent,
+											Datum *caseval, bool *casenull,
+											struct JsonbValue **item);
 extern ExprState *ExecInitQual(List *qual, PlanState *parent);
 extern ExprState *ExecInitCheck(List *qual, PlanState *parent);
 extern List *ExecInitExprList(List *nodes, PlanState *parent);
@@ -265,6 +270,13 @@ extern ExprState *ExecBuildGroupingEqual(TupleDesc ldesc, TupleDesc rdesc,
 										 const Oid *eqfunctions,
 										 const Oid *collations,
 										 PlanState *parent);
+extern ExprState *ExecBuildParamSetEqual(TupleDesc desc,
+										 const TupleTableSlotOps *lops,
+										 const TupleTableSlotOps *rops,
+										 const Oid *eqfunctions,
+										 const Oid *collations,
+										 const List *param_exprs,
+										 PlanState *parent);
 extern ProjectionInfo *ExecBuildProjectionInfo(List *targetList,
 											   ExprContext *econtext,
 											   TupleTableSlot *slot,
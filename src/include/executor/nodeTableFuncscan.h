@@ -14,10 +14,21 @@
 #ifndef NODETABLEFUNCSCAN_H
 #define NODETABLEFUNCSCAN_H
 
+#include "access/parallel.h"
 #include "nodes/execnodes.h"
 
 extern TableFuncScanState *ExecInitTableFuncScan(TableFuncScan *node, EState *estate, int eflags);
 extern void ExecEndTableFuncScan(TableFuncScanState *node);
 extern void ExecReScanTableFuncScan(TableFuncScanState *node);
 
+/* parallel scan support */
+extern void ExecTableFuncScanEstimate(TableFuncScanState *node,
+									  ParallelContext *pcxt);
+extern void ExecTableFuncScanInitializeDSM(TableFuncScanState *node,
+										   ParallelContext *pcxt);
+extern void ExecTableFuncScanReInitializeDSM(TableFuncScanState *node,
+											 ParallelContext *pcxt);
+extern void ExecTableFuncScanInitializeWorker(TableFuncScanState *node,
+											  ParallelWorkerContext *pwcxt);
+
 #endif							/* NODETABLEFUNCSCAN_H */
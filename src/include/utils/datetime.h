@@ -296,6 +296,9 @@ extern int	DecodeDateTime(char **field, int *ftype,
 						   int nf, int *dtype,
 						   struct pg_tm *tm, fsec_t *fsec, int *tzp);
 extern int	DecodeTimezone(char *str, int *tzp);
+extern bool DecodeISO8601DateTime(const char *str, int len, struct pg_tm *tm,
+								  fsec_t *fsec, bool *has_time, bool *has_tz,
+								  int *tzp);
 extern int	DecodeTimeOnly(char **field, int *ftype,
 						   int nf, int *dtype,
 						   struct pg_tm *tm, fsec_t *fsec, int *tzp);
@@ -106,6 +106,16 @@ typedef struct JsonbValue JsonbValue;
  * an array with one element, with the flags in the array's header field set
  * to JB_FSCALAR | JB_FARRAY.
  *
+ * The header of the root container may also have the JB_FCANONICAL flag set,
+ * meaning that the value is known to be stored in its canonical form: no
+ * numeric in it has trailing fractional zeros, so that any two values having
+ * the flag are equal if and only if their binary representations are
+ * identical.  The flag is never set in nested containers, and values that
+ * don't have it (e.g. those written by older versions) simply have to be
+ * compared the slow way.  Should the encoding ever change so that equal
+ * values may be represented differently, e.g. because of a different
+ * offset-placement heuristic, the new encoder must not set this flag.
+ *
  * Overall, the Jsonb struct requires 4-bytes alignment. Within the struct,
  * the variable-length portion of some node types is aligned to a 4-byte
  * boundary, while others are not. When alignment is needed, the padding is
@@ -113,6 +123,14 @@ typedef struct JsonbValue JsonbValue;
  * node is stored after a string node, so that the numeric node begins at
  * offset 3, the variable-length portion of the numeric node will begin with
  * one padding byte so that the actual numeric data is 4-byte aligned.
+ *
+ * Object keys are always stored inline, as plain strings, in every object
+ * that contains them.  A Jsonb datum must be interpretable without any
+ * outside state: datums are copied between columns and relations, and are
+ * compared, hashed and indexed by code that has no idea which column they
+ * came from.  Keys therefore cannot be replaced by references to a
+ * per-column dictionary, and a key that appears in many rows is stored
+ * once in each of them.
  */
 
 /*
@@ -209,6 +227,7 @@ typedef struct JsonbContainer
 #define JB_FSCALAR				0x10000000	/* flag bits */
 #define JB_FOBJECT				0x20000000
 #define JB_FARRAY				0x40000000
+#define JB_FCANONICAL			0x80000000
 
 /* convenience macros for accessing a JsonbContainer struct */
 #define JsonContainerSize(jc)		((jc)->header & JB_CMASK)
@@ -228,6 +247,7 @@ typedef struct
 #define JB_ROOT_IS_SCALAR(jbp_) ((*(uint32 *) VARDATA(jbp_) & JB_FSCALAR) != 0)
 #define JB_ROOT_IS_OBJECT(jbp_) ((*(uint32 *) VARDATA(jbp_) & JB_FOBJECT) != 0)
 #define JB_ROOT_IS_ARRAY(jbp_)	((*(uint32 *) VARDATA(jbp_) & JB_FARRAY) != 0)
+#define JB_ROOT_IS_CANONICAL(jbp_) ((*(uint32 *) VARDATA(jbp_) & JB_FCANONICAL) != 0)
 
 
 enum jbvType
@@ -333,6 +353,12 @@ typedef struct JsonbParseState
 	bool		skip_nulls;		/* Skip null object fields */
 } JsonbParseState;
 
+/*
+ * State of streaming conversion of a sequence of values to Jsonb without
+ * building a JsonbValue tree (private to jsonb_util.c)
+ */
+typedef struct JsonbEncodeState JsonbEncodeState;
+
 /*
  * JsonbIterator holds details of the type for each iteration. It also stores a
  * Jsonb varlena buffer, which can be directly accessed in some contexts.
@@ -397,6 +423,8 @@ typedef enum					/* type categories for datum_to_jsonb */
 extern uint32 getJsonbOffset(const JsonbContainer *jc, int index);
 extern uint32 getJsonbLength(const JsonbContainer *jc, int index);
 extern int	compareJsonbContainers(JsonbContainer *a, JsonbContainer *b);
+extern bool equalsJsonb(Jsonb *a, Jsonb *b);
+extern uint64 getJsonbSortPrefix(JsonbContainer *jc);
 extern JsonbValue *findJsonbValueFromContainer(JsonbContainer *sheader,
 											   uint32 flags,
 											   JsonbValue *key);
@@ -407,6 +435,15 @@ extern JsonbValue *getIthJsonbValueFromContainer(JsonbContainer *sheader,
 												 uint32 i);
 extern JsonbValue *pushJsonbValue(JsonbParseState **pstate,
 								  JsonbIteratorToken seq, JsonbValue *jbval);
+extern JsonbEncodeState *startJsonbEncode(bool unique_keys);
+extern void encodeJsonbBeginContainer(JsonbEncodeState *state, bool isObject);
+extern void encodeJsonbKey(JsonbEncodeState *state, const char *key, int len);
+extern void encodeJsonbScalar(JsonbEncodeState *state, JsonbValue *scalarVal);
+extern void encodeJsonbEndContainer(JsonbEncodeState *state);
+extern void encodeJsonbBinary(JsonbEncodeState *state, Jsonb *jb);
+extern void encodeJsonbRemoveFirst(JsonbEncodeState *state);
+extern Jsonb *peekJsonbEncode(JsonbEncodeState *state);
+extern Jsonb *finishJsonbEncode(JsonbEncodeState *state);
 extern JsonbIterator *JsonbIteratorInit(JsonbContainer *container);
 extern JsonbIteratorToken JsonbIteratorNext(JsonbIterator **it, JsonbValue *val,
 											bool skipNested);
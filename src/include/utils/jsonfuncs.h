@@ -14,7 +14,9 @@
 #ifndef JSONFUNCS_H
 #define JSONFUNCS_H
 
+#include "access/tupdesc.h"
 #include "common/jsonapi.h"
+#include "fmgr.h"
 #include "utils/jsonb.h"
 
 /*
@@ -58,6 +60,41 @@ extern Jsonb *transform_jsonb_string_values(Jsonb *jsonb, void *action_state,
 extern text *transform_json_string_values(text *json, void *action_state,
 										  JsonTransformStringValuesAction transform_action);
 
+/* computes the json or jsonb category and output function of a type */
+typedef void (*JsonCategorizeTypeFunc) (Oid typoid, int *tcategory,
+										Oid *outfuncoid);
+
+/* Conversion of one attribute in JsonCompositePlan */
+typedef struct JsonCompositeColumn
+{
+	AttrNumber	attnum;			/* attribute number */
+	char	   *key;			/* attribute name, for json escaped and
+								 * followed by ':' */
+	int			keylen;			/* length of key */
+	int			tcategory;		/* category from JsonCategorizeTypeFunc */
+	Oid			outfuncoid;		/* output or cast function */
+	FmgrInfo	outfunc;		/* its lookup info, if outfuncoid is valid */
+} JsonCompositeColumn;
+
+/*
+ * Per-rowtype conversion plan for composite_to_json() and composite_to_jsonb(),
+ * see json_composite_plan_acquire().
+ */
+typedef struct JsonCompositePlan
+{
+	MemoryContext mcxt;			/* context holding the plan */
+	uint64		tupdesc_id;		/* identifier of tupdesc the plan is for */
+	int			refcount;		/* number of active users of the plan */
+	bool		obsolete;		/* delete the plan when refcount drops to 0 */
+	int			ncolumns;		/* number of non-dropped attributes */
+	JsonCompositeColumn columns[FLEXIBLE_ARRAY_MEMBER];
+} JsonCompositePlan;
+
+extern JsonCompositePlan *json_composite_plan_acquire(TupleDesc tupdesc,
+													  bool is_jsonb,
+													  JsonCategorizeTypeFunc categorize);
+extern void json_composite_plan_release(JsonCompositePlan *plan);
+
 extern Datum json_populate_type(Datum json_val, Oid json_type,
 								Oid typid, int32 typmod,
 								void **cache, MemoryContext mcxt, bool *isnull);
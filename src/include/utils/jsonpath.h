@@ -179,6 +179,12 @@ extern bool jspGetArraySubscript(JsonPathItem *v, JsonPathItem *from,
 								 JsonPathItem *to, int i);
 extern bool jspIsMutable(JsonPath *path, List *varnames, List *varexprs);
 
+/* Flags reported by jspEstimateCost() */
+#define JSP_COST_HAS_VARIABLES	0x01	/* $variable references */
+#define JSP_COST_HAS_DATETIME	0x02	/* .datetime() item methods */
+
+extern int	jspEstimateCost(JsonPathItem *jsp, int *flags);
+
 extern const char *jspOperationName(JsonPathItemType type);
 
 /*
@@ -268,17 +274,22 @@ typedef struct JsonPathVariableEvalContext
 	Datum		value;
 	bool		isnull;
 	bool		evaluated;
+	JsonbValue	jbv;			/* value converted to SQL/JSON item */
 } JsonPathVariableEvalContext;
 
 /* SQL/JSON item */
 extern void JsonItemFromDatum(Datum val, Oid typid, int32 typmod,
 							  JsonbValue *res);
 
-extern bool  JsonPathExists(Datum jb, JsonPath *path, List *vars, bool *error);
-extern Datum JsonPathQuery(Datum jb, JsonPath *jp, JsonWrapper wrapper,
-						   bool *empty, bool *error, List *vars);
-extern JsonbValue *JsonPathValue(Datum jb, JsonPath *jp, bool *empty,
-								 bool *error, List *vars);
+extern bool  JsonPathExists(Datum jb, Oid typid, JsonPath *path, List *vars,
+							bool *error);
+extern Datum JsonPathQuery(Datum jb, Oid typid, JsonPath *jp,
+						   JsonWrapper wrapper, bool *empty, bool *error,
+						   List *vars);
+extern JsonbValue *JsonPathValue(Datum jb, Oid typid, JsonPath *jp,
+								 bool *empty, bool *error, List *vars);
+extern Datum JsonItemQuery(JsonbValue *item, JsonWrapper wrapper);
+extern JsonbValue *JsonItemValue(JsonbValue *item, bool *error);
 
 extern int EvalJsonPathVar(void *vars, char *varName, int varNameLen,
 						   JsonbValue *val, JsonbValue *baseObject);
@@ -73,5 +73,13 @@ extern Numeric numeric_div_opt_error(Numeric num1, Numeric num2,
 extern Numeric numeric_mod_opt_error(Numeric num1, Numeric num2,
 									 bool *have_error);
 extern int32 numeric_int4_opt_error(Numeric num, bool *error);
+extern Numeric int64_to_numeric(int64 val);
+extern bool numeric_get_int64(Numeric num, int64 *result);
+extern bool numeric_is_canonical(Numeric num);
+
+/* numeric_sort_prefix() results are within +/- this value */
+#define NUMERIC_SORT_PREFIX_MAX		(1 << 24)
+
+extern int32 numeric_sort_prefix(Numeric num);
 
 #endif							/* _PG_NUMERIC_H_ */
@@ -164,6 +164,40 @@ SELECT row_to_json(q)
 FROM (SELECT '{"a":1,"b": [2,3,4,"d","e","f"],"c":{"p":1,"q":2}}'::json AS "jsonfield") q;
 
 
+-- conversion plans follow changes of the rowtype
+CREATE TEMP TABLE rowtype_json (a int, b text);
+INSERT INTO rowtype_json VALUES (1, 'x');
+SELECT row_to_json(t) FROM rowtype_json t;
+ALTER TABLE rowtype_json DROP COLUMN a, ADD COLUMN c numeric;
+SELECT row_to_json(t) FROM rowtype_json t;
+DROP TABLE rowtype_json;
+
+-- conversion plans follow pg_cast changes and survive errors
+CREATE TYPE rowtype_mood AS ENUM ('happy', 'sad');
+CREATE TEMP TABLE rowtype_json_mood (m rowtype_mood);
+INSERT INTO rowtype_json_mood VALUES ('happy');
+SELECT row_to_json(t) FROM rowtype_json_mood t;
+CREATE FUNCTION rowtype_mood_to_json(rowtype_mood) RETURNS json
+LANGUAGE plpgsql AS $$
+BEGIN
+  IF $1 = 'sad' THEN
+    RAISE EXCEPTION 'no json for sad';
+  END IF;
+  RETURN json_build_object('mood', $1::text);
+END
+$$;
+CREATE CAST (rowtype_mood AS json) WITH FUNCTION rowtype_mood_to_json(rowtype_mood);
+SELECT row_to_json(t) FROM rowtype_json_mood t;
+INSERT INTO rowtype_json_mood VALUES ('sad');
+SELECT row_to_json(t) FROM rowtype_json_mood t;
+DELETE FROM rowtype_json_mood WHERE m = 'sad';
+SELECT row_to_json(t) FROM rowtype_json_mood t;
+DROP CAST (rowtype_mood AS json);
+DROP FUNCTION rowtype_mood_to_json(rowtype_mood);
+SELECT row_to_json(t) FROM rowtype_json_mood t;
+DROP TABLE rowtype_json_mood;
+DROP TYPE rowtype_mood;
+
 -- json extraction functions
 
 CREATE TEMP TABLE test_json (
@@ -323,6 +357,13 @@ select json_extract_path_text('{"f2":{"f3":1},"f4":{"f5":null,"f6":"stringy"}}',
 select json_extract_path('{"f2":{"f3":1},"f4":[0,1,2,null]}','f4','3') is null as expect_false;
 select json_extract_path_text('{"f2":{"f3":1},"f4":[0,1,2,null]}','f4','3') is null as expect_true;
 
+-- extract_path stops parsing once the rest can't match again
+select '[{"a": 1}, {"a": 2}, 3]'::json #> '{1,a}';
+select '{"a": 1, "b": {"a": 2}, "a": 3}'::json -> 'a';
+select '{"a": {"b": 1}, "c": "\"a\"", "a": {"b": 2}}'::json #>> '{a,b}';
+select '{"a": [1, {"b": 2}], "b": 3}'::json #>> '{a,1,b}';
+select '{"a": [1, {"b": 2}], "a": [4]}'::json #>> '{a,1,b}';
+
 -- extract_path operators
 
 select '{"f2":{"f3":1},"f4":{"f5":99,"f6":"stringy"}}'::json#>array['f4','f6'];
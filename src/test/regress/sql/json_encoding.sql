@@ -42,6 +42,7 @@ select json '{ "a":  "dollar \u0024 character" }' ->> 'a' as correct_everywhere;
 select json '{ "a":  "dollar \\u0024 character" }' ->> 'a' as not_an_escape;
 select json '{ "a":  "null \u0000 escape" }' ->> 'a' as fails;
 select json '{ "a":  "null \\u0000 escape" }' ->> 'a' as not_an_escape;
+select json '[{ "a":  "dollar" }, "null \u0000 escape"]' #>> '{0,a}' as fails;
 
 -- then jsonb
 
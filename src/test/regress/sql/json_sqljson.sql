@@ -1,14 +1,30 @@
 -- JSON_EXISTS
 
 SELECT JSON_EXISTS(NULL FORMAT JSON, '$');
+SELECT JSON_EXISTS(json '{"a": {"b": [1, 2]}}', '$.a.b[1]');
+SELECT JSON_EXISTS(json '{"a": {"b": [1, 2]}}', '$.a.b[2]');
+SELECT JSON_EXISTS(json '{"a": {"b": [1, 2]}}', 'strict $.a.c');
+SELECT JSON_EXISTS(json '[{"a": 1}, {"b": 2}]', '$.a');
+SELECT JSON_EXISTS('{"a": 1}', '$.a');
 
 -- JSON_VALUE
 
 SELECT JSON_VALUE(NULL FORMAT JSON, '$');
+SELECT JSON_VALUE(json '{"a": {"b": [1, "foo"]}}', '$.a.b[1]');
+SELECT JSON_VALUE(json '{"a": {"b": [1, "foo"]}}', '$.a.b[0]' RETURNING int);
+SELECT JSON_VALUE(json '{"a": 1, "a": 2}', '$.a');
+SELECT JSON_VALUE(json '{"a": {"b": 1}, "a": {"c": 2}}', '$.a.b');
+SELECT JSON_VALUE(json '{"a": [1, 2]}', '$.a' ERROR ON ERROR);
+SELECT JSON_VALUE(json '[1, 2]', 'strict $[5]' RETURNING int DEFAULT -1 ON ERROR);
+SELECT JSON_VALUE(json '[1, 2]', '$[$i]' PASSING 1 AS i);
 
 -- JSON_QUERY
 
 SELECT JSON_QUERY(NULL FORMAT JSON, '$');
+SELECT JSON_QUERY(json '{"a": {"c": 1, "b": [1, 2]}}', '$.a');
+SELECT JSON_QUERY(json '{"a": [1, 2]}', '$.a[*]' WITH WRAPPER);
+SELECT JSON_QUERY(json '{"a": "foo"}', '$.a' RETURNING text OMIT QUOTES);
+SELECT pg_typeof(JSON_QUERY(json '{"a": 1}', '$.a'));
 
 -- JSON_TABLE
 
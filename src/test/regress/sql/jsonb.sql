@@ -41,6 +41,14 @@ SELECT '{"abc":1,"def":2,"ghi":[3,4],"hij":{"klm":5,"nop":[6]}}'::jsonb; -- OK
 SELECT '{"abc":1:2}'::jsonb;		-- ERROR, colon in wrong spot
 SELECT '{"abc":1,3}'::jsonb;		-- ERROR, no value
 
+-- Nested containers, duplicate keys and containers large enough to store offsets
+SELECT '{"a": {"y": 1, "x": 2}, "a": {"z": [1, 2.5]}, "b": "c"}'::jsonb;
+SELECT ('[' || string_agg(format('"%s", %s.5', repeat('x', i % 3), i), ', ') || ']')::jsonb -> 71
+FROM generate_series(1, 40) i;
+SELECT j -> 'k7', j -> 'k33', (SELECT count(*) FROM jsonb_object_keys(j))
+FROM (SELECT ('{' || string_agg(format('"k%s": {"a": [%s, "x"], "a": %s.5}', i, i, i), ', ') || '}')::jsonb j
+      FROM generate_series(1, 40) i) s;
+
 -- Recursion.
 SET max_stack_depth = '100kB';
 SELECT repeat('[', 10000)::jsonb;
@@ -113,6 +121,54 @@ UPDATE rows SET x = NULL WHERE x = 1;
 SELECT jsonb_agg(q ORDER BY x NULLS FIRST, y)
   FROM rows q;
 
+-- jsonb values are spliced into the result as is
+SELECT jsonb_agg(v)
+  FROM (VALUES ('1.5'::jsonb), ('"str"'), ('null'), (NULL), ('true'),
+               ('[1, {"a": [2]}]'), ('{"b": 3.0, "a": []}')) t(v);
+
+SELECT j = (j::text)::jsonb AS same, jsonb_array_length(j), j -> 40, j -> 63
+  FROM (SELECT jsonb_agg(CASE i % 3
+                           WHEN 0 THEN to_jsonb(i)
+                           WHEN 1 THEN jsonb_build_object('i', i)
+                           ELSE jsonb_build_array(i, i::text)
+                         END) AS j
+        FROM generate_series(1, 64) i) s;
+
+-- moving-aggregate mode
+SELECT i, jsonb_agg(jsonb_build_object('i', i, 'a', repeat('x', i)))
+              OVER (ORDER BY i ROWS 1 PRECEDING)
+  FROM generate_series(1, 4) i;
+
+-- conversion plans follow changes of the rowtype
+CREATE TEMP TABLE rowtype_jsonb (a int, b text);
+INSERT INTO rowtype_jsonb VALUES (1, 'x');
+SELECT to_jsonb(t) FROM rowtype_jsonb t;
+ALTER TABLE rowtype_jsonb DROP COLUMN a, ADD COLUMN c numeric;
+SELECT to_jsonb(t) FROM rowtype_jsonb t;
+DROP TABLE rowtype_jsonb;
+
+-- small integers take fast paths in output and comparisons
+SELECT '[1, -42, 1234567890123456, -12345678901234567, 1.0, 0, -0]'::jsonb AS j,
+       '[1234567890123456]'::jsonb ->> 0 AS "->>",
+       '1'::jsonb = '1.00'::jsonb AS eq,
+       '{"a": 2}'::jsonb < '{"a": 10}'::jsonb AS lt;
+
+-- equality compares bytes when both values are in canonical form
+SELECT a, b, a::jsonb = b::jsonb AS eq, a::jsonb <> b::jsonb AS ne
+  FROM (VALUES ('{"a": 1, "b": [true, "x"]}', '{"b": [true, "x"], "a": 1}'),
+               ('{"a": 1}', '{"a": 2}'),
+               ('[1.0, 2]', '[1, 2.00]'),
+               ('[1.5, 2]', '[1.50, 2]'),
+               ('[0.10]', '[0.1]'),
+               ('1e2', '100')) v(a, b);
+
+SELECT jsonb_agg(j) = '[1, 2]' AS canonical, jsonb_agg(j) = '[1.0, 2]' AS mixed
+  FROM (VALUES ('1'::jsonb), ('2')) v(j);
+
+SELECT count(*) AS n, count(DISTINCT j::text) AS reprs
+  FROM (VALUES ('{"a": 1.0}'::jsonb), ('{"a": 1}'), ('{"a": 1.00}'), ('[1]')) v(j)
+  GROUP BY j ORDER BY n;
+
 -- jsonb extraction functions
 CREATE TEMP TABLE test_jsonb (
        json_type text,
@@ -504,6 +560,11 @@ SELECT jsonb_array_elements('[1,true,[1,[2,3]],null,{"f1":1,"f2":[7,8,9]},false]
 SELECT * FROM jsonb_array_elements('[1,true,[1,[2,3]],null,{"f1":1,"f2":[7,8,9]},false]') q;
 SELECT jsonb_array_elements_text('[1,true,[1,[2,3]],null,{"f1":1,"f2":[7,8,9]},false,"stringy"]');
 SELECT * FROM jsonb_array_elements_text('[1,true,[1,[2,3]],null,{"f1":1,"f2":[7,8,9]},false,"stringy"]') q;
+-- value-per-call mode
+SELECT jsonb_array_elements_text('[1, "a", null, [2], {"b": 3}]'),
+       jsonb_array_elements('[true, false]');
+SELECT jsonb_array_elements('[1, 2, 3, 4]') LIMIT 2;
+SELECT EXISTS (SELECT jsonb_object_keys('{"a": 1, "b": {"c": 2}}'));
 
 -- populate_record
 CREATE TYPE jbpop AS (a text, b int, c timestamp);
@@ -726,6 +787,13 @@ select * from jsonb_to_record('{"out": {"key": 1}}') as x(out jsonb);
 select * from jsonb_to_record('{"out": [{"key": 1}]}') as x(out jsonb);
 select * from jsonb_to_record('{"out": "{\"key\": 1}"}') as x(out jsonb);
 
+-- direct conversion of scalars
+select * from jsonb_to_record('{"b": true, "aa": 12, "a": "x", "ccc": 1.50, "d": 32767, "e": 9007199254740993, "zz": "ignored"}')
+  as x(ccc numeric(5,1), a text, aa int4, b bool, d int2, e int8, missing int);
+select * from jsonb_to_record('{"a":1,"b":2,"c":3,"d":4,"e":5,"f":6}') as x(f int);
+select * from jsonb_to_record('{"a": 1.5}') as x(a int);
+select * from jsonb_to_record('{"a": 40000}') as x(a int2);
+
 -- test type info caching in jsonb_populate_record()
 CREATE TEMP TABLE jsbpoptest (js jsonb);
 
@@ -855,6 +923,36 @@ RESET enable_sort;
 
 DROP INDEX jidx;
 DROP INDEX jidx_array;
+-- sort order, using abbreviated keys
+SELECT j FROM (VALUES ('{"a": 1}'::jsonb), ('[]'), ('null'), ('"x"'), ('1'),
+  ('-1.5'), ('[1]'), ('[1, 2]'), ('[null]'), ('["b"]'), ('[true]'), ('[[1]]'),
+  ('[{}]'), ('true'), ('{}'), ('{"a": [1]}'), ('{"b": 0}'), ('10'), ('[2]'),
+  ('[-3]')) v(j)
+ORDER BY j;
+
+-- numbers whose weight does not fit in the abbreviated key
+CREATE TABLE test_jsonb_sort_prefix (label text, j jsonb);
+INSERT INTO test_jsonb_sort_prefix
+SELECT s.minus || v.l, jsonb_build_array(s.sign * v.n)
+FROM (VALUES ('huge', repeat('9', 2100)::numeric),
+             ('huger', ('1' || repeat('0', 2200))::numeric),
+             ('tiny', ('0.' || repeat('0', 2100) || '1')::numeric),
+             ('tinier', ('0.' || repeat('0', 2200) || '9999')::numeric),
+             ('one', 1)) v(l, n),
+     (VALUES (1, ''), (-1, '-')) s(sign, minus)
+UNION ALL
+SELECT 'zero', '[0]';
+SELECT label FROM test_jsonb_sort_prefix ORDER BY j;
+CREATE INDEX test_jsonb_sort_prefix_idx ON test_jsonb_sort_prefix (j);
+SET enable_seqscan = off;
+SELECT label FROM test_jsonb_sort_prefix ORDER BY j;
+SELECT label FROM test_jsonb_sort_prefix
+WHERE j = jsonb_build_array(repeat('9', 2100)::numeric);
+SELECT label FROM test_jsonb_sort_prefix
+WHERE j = jsonb_build_array(-('0.' || repeat('0', 2200) || '9999')::numeric);
+RESET enable_seqscan;
+DROP TABLE test_jsonb_sort_prefix;
+
 -- btree
 CREATE INDEX jidx ON testjsonb USING btree (j);
 SET enable_seqscan = off;
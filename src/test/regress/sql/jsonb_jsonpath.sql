@@ -109,6 +109,8 @@ select * from jsonb_path_query('[10,11,12,13,14,15]', '$[0 to 2] ? (@ < $value)'
 select * from jsonb_path_query('[1,"1",2,"2",null]', '$[*] ? (@ == "1")');
 select * from jsonb_path_query('[1,"1",2,"2",null]', '$[*] ? (@ == $value)', '{"value" : "1"}');
 select * from jsonb_path_query('[1,"1",2,"2",null]', '$[*] ? (@ == $value)', '{"value" : null}');
+select jsonb_path_query_array('[1, 2, 3, 4, 5, 6, 7, 8]', '$[*] ? (@ > $min && @ % $n == 0)', '{"min": 2, "n": 3}');
+select jsonb_path_query('{"a": [1, 2]}', p::jsonpath) from (values ('$.a[*]'), ('strict $.a[1]'), ('$.a[*]')) v(p);
 select * from jsonb_path_query('[1, "2", null]', '$[*] ? (@ != null)');
 select * from jsonb_path_query('[1, "2", null]', '$[*] ? (@ == null)');
 select * from jsonb_path_query('{}', '$ ? (@ == @)');
@@ -208,6 +210,18 @@ select jsonb '{"c": {"a": -1, "b":1}}' @? '$.** ? (@.a == - @.b)';
 select jsonb '{"c": {"a": 0, "b":1}}' @? '$.** ? (@.a == 1 - @.b)';
 select jsonb '{"c": {"a": 2, "b":1}}' @? '$.** ? (@.a == 1 - - @.b)';
 select jsonb '{"c": {"a": 0, "b":1}}' @? '$.** ? (@.a == 1 - +@.b)';
+
+-- .** skips subtrees of large documents which can't contain the required key
+select
+  jsonb_path_query_array(js, '$.**.id') as ids,
+  jsonb_path_query_array(js, 'strict $.**.id') as strict_ids,
+  jsonb_path_query_array(js, '$.** ? (@.type == "x").id') as filtered,
+  jsonb_path_query_array(js, '$.**.pad') as pad,
+  jsonb_path_query_array(js, '$.** ? (exists (@.x) && @.x > 98).x') as xs
+from (
+  select jsonb_build_object('a', jsonb_agg(jsonb_build_object('x', i, 'y', jsonb_build_array(i, 'pad')) order by i),
+                            'b', jsonb '{"c": {"id": 42, "type": "x"}, "d": [{"id": 43}]}') as js
+  from generate_series(1, 100) i) t;
 select jsonb '[1,2,3]' @? '$ ? (+@[*] > +2)';
 select jsonb '[1,2,3]' @? '$ ? (+@[*] > +3)';
 select jsonb '[1,2,3]' @? '$ ? (-@[*] < -2)';
@@ -233,6 +247,16 @@ select jsonb '[1,"2",0,3]' @? '-$[*]';
 select jsonb '["1",2,0,3]' @? 'strict -$[*]';
 select jsonb '[1,"2",0,3]' @? 'strict -$[*]';
 
+-- integral operands of arithmetic and overflow to numeric
+select jsonb_path_query('[9999999999999999, 2]', '$[0] * $[1]');
+select jsonb_path_query('[9999999999999999, 9999999999999999]', '$[0] * $[1]');
+select jsonb_path_query('[9223372036854775807, 1]', '$[0] + $[1]');
+select jsonb_path_query('[10000000000000000, 1]', '$[0] - $[1]');
+select jsonb_path_query('[-7, 3]', '$[0] % $[1]');
+select jsonb_path_query('[7, -3]', '$[0] % $[1]');
+select jsonb_path_query('[1.0, 2]', '$[0] + $[1]');
+select jsonb_path_query('[1, 2, 3]', '$[*] ? (@ * 1000000000000 > 1500000000000)');
+
 -- unwrapping of operator arguments in lax mode
 select jsonb_path_query('{"a": [2]}', 'lax $.a * 3');
 select jsonb_path_query('{"a": [2]}', 'lax $.a + 3');
@@ -347,6 +371,10 @@ select jsonb_path_query('[null, 1, "a\b", "a\\b", "^a\\b$"]', 'lax $[*] ? (@ lik
 select jsonb_path_query('[null, 1, "a\b", "a\\b", "^a\\b$"]', 'lax $[*] ? (@ like_regex "^a\\B$" flag "iq")');
 select jsonb_path_query('[null, 1, "a\b", "a\\b", "^a\\b$"]', 'lax $[*] ? (@ like_regex "^a\\b$" flag "")');
 
+select jsonb_path_query('[{"a": "xy", "b": 1}, {"a": "xz", "b": 2}, {"a": 1, "b": 1}]', '$[*] ? (@.a like_regex "^x" && @.b == 1)');
+select jsonb_path_query('[{"a": "xy", "b": 1}, {"a": "xz", "b": 2}, {"a": 1, "b": 1}]', '$[*] ? ((@.a like_regex "^x" && @.b == 1) is unknown)');
+select jsonb_path_query('[{"a": "xy", "b": 1}, {"a": "xz", "b": 2}, {"a": 1, "b": 1}]', '$[*] ? (@.a like_regex "^x" || @.b == 1)');
+
 select jsonb_path_query('null', '$.datetime()');
 select jsonb_path_query('true', '$.datetime()');
 select jsonb_path_query('1', '$.datetime()');
@@ -27,6 +27,8 @@ SELECT JSON_EXISTS(jsonb '{"a": 1, "b": 2}', '$.* ? (@ > $x)' PASSING 1 AS x);
 SELECT JSON_EXISTS(jsonb '{"a": 1, "b": 2}', '$.* ? (@ > $x)' PASSING '1' AS x);
 SELECT JSON_EXISTS(jsonb '{"a": 1, "b": 2}', '$.* ? (@ > $x && @ < $y)' PASSING 0 AS x, 2 AS y);
 SELECT JSON_EXISTS(jsonb '{"a": 1, "b": 2}', '$.* ? (@ > $x && @ < $y)' PASSING 0 AS x, 1 AS y);
+SELECT JSON_QUERY(jsonb '[1, 2, 3, 4, 5]', '$[*] ? (@ >= $xy && @ != $x)' PASSING 2 AS xy, 3 AS x WITH WRAPPER);
+SELECT JSON_QUERY(to_jsonb(array(SELECT generate_series(1, 100))), '$[*] ? (@ % $n == 0 && @ > $min)' PASSING 7 AS n, 50 AS min WITH WRAPPER);
 
 -- extension: boolean expressions
 SELECT JSON_EXISTS(jsonb '1', '$ > 2');
@@ -82,6 +84,18 @@ SELECT JSON_VALUE(jsonb '"123"', '$' RETURNING int) + 234;
 
 SELECT JSON_VALUE(jsonb '"2017-02-20"', '$' RETURNING date) + 9;
 
+-- Direct conversions of numbers and ISO dates
+SELECT JSON_VALUE(jsonb '123', '$' RETURNING int2) AS i2,
+       JSON_VALUE(jsonb '-9007199254740993', '$' RETURNING int8) AS i8,
+       JSON_VALUE(jsonb '3', '$' RETURNING float8) AS f8,
+       JSON_VALUE(jsonb '1.5', '$' RETURNING int2) AS rounded;
+SELECT JSON_VALUE(jsonb '40000', '$' RETURNING int2 ERROR ON ERROR);
+SELECT JSON_VALUE(jsonb '"2020-02-29"', '$' RETURNING date) AS d,
+       JSON_VALUE(jsonb '"2020-02-29T10:20:30.123456"', '$' RETURNING timestamp) AS ts,
+       JSON_VALUE(jsonb '"2020-02-29 10:20:30.5+03:30"', '$' RETURNING timestamptz) AS tstz,
+       JSON_VALUE(jsonb '"2020-07-01 12:00"', '$' RETURNING timestamptz) AS tstz_local;
+SELECT JSON_VALUE(jsonb '"2020-02-30"', '$' RETURNING date ERROR ON ERROR);
+
 -- Test NULL checks execution in domain types
 CREATE DOMAIN sqljsonb_int_not_null AS int NOT NULL;
 SELECT JSON_VALUE(jsonb '1', '$.a' RETURNING sqljsonb_int_not_null);
@@ -316,6 +330,10 @@ CREATE INDEX ON test_jsonb_mutability (JSON_QUERY(js, '$[1, 0 to $.a ? (@.dateti
 CREATE INDEX ON test_jsonb_mutability (JSON_QUERY(js, '$[1, $.a ? (@.datetime("HH:MI") == $x)]' PASSING '12:34'::time AS x));
 DROP TABLE test_jsonb_mutability;
 
+-- Test plan-time evaluation of query functions with constant arguments
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT JSON_QUERY(jsonb '{"a": [1, 2]}', '$.a'), JSON_VALUE(jsonb '{"a": 1}', '$.a' RETURNING int), JSON_EXISTS(jsonb '{"a": 1}', '$.b');
+
 -- JSON_TABLE
 
 -- Should fail (JSON_TABLE can be used only in FROM clause)
@@ -467,6 +485,28 @@ SELECT * FROM JSON_TABLE(jsonb '"a"', '$' COLUMNS (a int PATH '$'   DEFAULT 1 ON
 SELECT * FROM JSON_TABLE(jsonb '"a"', '$' COLUMNS (a int PATH 'strict $.a' DEFAULT 1 ON EMPTY DEFAULT 2 ON ERROR)) jt;
 SELECT * FROM JSON_TABLE(jsonb '"a"', '$' COLUMNS (a int PATH 'lax $.a' DEFAULT 1 ON EMPTY DEFAULT 2 ON ERROR)) jt;
 
+-- JSON_TABLE: columns with simple paths are extracted in a single pass
+SELECT *
+FROM
+	(VALUES
+		('{"b": 2, "a": 1, "ab": "x", "c": {"d": 3}}'),
+		('{"a": [1, 2], "ab": null}'),
+		('[{"a": 5}]'),
+		('"a"')
+	) vals(js),
+	JSON_TABLE(
+		vals.js::jsonb, '$'
+		COLUMNS (
+			ab text,
+			a int PATH '$.a',
+			a2 text PATH 'strict $."a"' DEFAULT 'err' ON ERROR,
+			b int PATH '$.b' DEFAULT -1 ON EMPTY,
+			c text FORMAT JSON PATH '$.c',
+			cd int PATH '$.c.d',
+			b_exists bool EXISTS PATH '$.b'
+		)
+	) jt;
+
 -- JSON_TABLE: EXISTS PATH types
 SELECT * FROM JSON_TABLE(jsonb '"a"', '$' COLUMNS (a int4 EXISTS PATH '$.a'));
 SELECT * FROM JSON_TABLE(jsonb '"a"', '$' COLUMNS (a int2 EXISTS PATH '$.a'));
@@ -905,6 +945,23 @@ from
 		plan(p outer ((pb inner pb1) cross (pc outer pc1)))
 	) jt;
 
+-- Nested items of the right side of a cross join are memoized
+SELECT *
+FROM
+	JSON_TABLE(jsonb
+		'{"a": [1, 2], "b": [{"c": [[1, 2], [3]]}, {"c": [[4]]}]}',
+		'$' AS p
+		COLUMNS (
+			NESTED PATH '$.a[*]' AS pa COLUMNS (a int PATH '$'),
+			NESTED PATH '$.b[*]' AS pb COLUMNS (
+				NESTED PATH '$.c[*]' AS pc COLUMNS (
+					NESTED PATH '$[*]' AS pd COLUMNS (d int PATH '$')
+				)
+			)
+		)
+		PLAN (p INNER (pa CROSS (pb INNER (pc INNER pd))))
+	) jt;
+
 -- Should succeed (JSON arguments are passed to root and nested paths)
 SELECT *
 FROM
@@ -957,3 +1014,28 @@ SELECT sum(JSON_VALUE(js, '$' RETURNING numeric)) FROM test_parallel_jsonb_value
 EXPLAIN (COSTS OFF)
 SELECT sum(JSON_VALUE(js, '$' RETURNING numeric ERROR ON ERROR)) FROM test_parallel_jsonb_value;
 SELECT sum(JSON_VALUE(js, '$' RETURNING numeric ERROR ON ERROR)) FROM test_parallel_jsonb_value;
+
+-- Test parallel JSON_TABLE()
+SELECT jsonb_agg(i) AS jsonb_table_doc FROM generate_series(1, 10000) i \gset
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+
+-- Should be non-parallel due to subtransactions
+EXPLAIN (COSTS OFF)
+SELECT count(*), sum(id), sum(n)
+FROM JSON_TABLE(:'jsonb_table_doc'::jsonb, '$[*]'
+	COLUMNS (id FOR ORDINALITY, n int PATH '$'));
+
+-- Should be parallel
+EXPLAIN (COSTS OFF)
+SELECT count(*), sum(id), sum(n)
+FROM JSON_TABLE(:'jsonb_table_doc'::jsonb, '$[*]'
+	COLUMNS (id FOR ORDINALITY, n int PATH '$') ERROR ON ERROR);
+SELECT count(*), sum(id), sum(n)
+FROM JSON_TABLE(:'jsonb_table_doc'::jsonb, '$[*]'
+	COLUMNS (id FOR ORDINALITY, n int PATH '$') ERROR ON ERROR);
+
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
@@ -15,6 +15,8 @@ select '$[0]'::jsonpath;
 select '$[*][0]'::jsonpath;
 select '$[*].a'::jsonpath;
 select '$[*][0].a.b'::jsonpath;
+select ' STRICT$.size.last[12]._a1.* '::jsonpath;
+select '$.size()'::jsonpath;
 select '$.a.**.b'::jsonpath;
 select '$.a.**{2}.b'::jsonpath;
 select '$.a.**{2 to 2}.b'::jsonpath;
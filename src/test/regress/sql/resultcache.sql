@@ -0,0 +1,136 @@
+-- Perform tests on the Result Cache node.
+
+-- The cache hits/misses/evictions from the Result Cache node can vary between
+-- machines.  Let's just replace the number with an 'N'.  In order to allow us
+-- to perform validation when the measure was zero, we replace a zero value
+-- with "Zero".  All other numbers are replaced with 'N'.
+create function explain_resultcache(query text, hide_hitmiss bool) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, summary off, timing off) %s',
+            query)
+    loop
+        if hide_hitmiss = true then
+                ln := regexp_replace(ln, 'Hits: 0', 'Hits: Zero');
+                ln := regexp_replace(ln, 'Hits: \d+', 'Hits: N');
+                ln := regexp_replace(ln, 'Misses: 0', 'Misses: Zero');
+                ln := regexp_replace(ln, 'Misses: \d+', 'Misses: N');
+                ln := regexp_replace(ln, 'loops=\d+', 'loops=N');
+        end if;
+        ln := regexp_replace(ln, 'Evictions: 0', 'Evictions: Zero');
+        ln := regexp_replace(ln, 'Evictions: \d+', 'Evictions: N');
+        ln := regexp_replace(ln, 'Memory Usage: \d+', 'Memory Usage: N');
+        ln := regexp_replace(ln, 'Heap Fetches: \d+', 'Heap Fetches: N');
+        return next ln;
+    end loop;
+end;
+$$;
+
+SET enable_resultcache TO on;
+
+-- Ensure we get a result cache on the inner side of the nested loop
+SET enable_hashjoin TO off;
+SET enable_bitmapscan TO off;
+SELECT explain_resultcache('
+SELECT COUNT(*),AVG(t1.unique1) FROM tenk1 t1
+INNER JOIN tenk1 t2 ON t1.unique1 = t2.twenty
+WHERE t2.unique1 < 1000;', false);
+
+-- And check we get the expected results.
+SELECT COUNT(*),AVG(t1.unique1) FROM tenk1 t1
+INNER JOIN tenk1 t2 ON t1.unique1 = t2.twenty
+WHERE t2.unique1 < 1000;
+
+-- Try with LATERAL joins
+SELECT explain_resultcache('
+SELECT COUNT(*),AVG(t2.unique1) FROM tenk1 t1,
+LATERAL (SELECT t2.unique1 FROM tenk1 t2 WHERE t1.twenty = t2.unique1) t2
+WHERE t1.unique1 < 1000;', false);
+
+-- And check we get the expected results.
+SELECT COUNT(*),AVG(t2.unique1) FROM tenk1 t1,
+LATERAL (SELECT t2.unique1 FROM tenk1 t2 WHERE t1.twenty = t2.unique1) t2
+WHERE t1.unique1 < 1000;
+
+-- Reduce work_mem so that we see some cache evictions
+SET work_mem TO '64kB';
+SET enable_mergejoin TO off;
+-- Ensure we get some evictions.  We're unable to validate the hits and misses
+-- here as the number of entries that fit in the cache at once will vary
+-- between different machines.
+SELECT explain_resultcache('
+SELECT COUNT(*),AVG(t1.unique1) FROM tenk1 t1
+INNER JOIN tenk1 t2 ON t1.unique1 = t2.thousand
+WHERE t2.unique1 < 1200;', true);
+RESET enable_mergejoin;
+RESET work_mem;
+
+RESET enable_bitmapscan;
+RESET enable_hashjoin;
+
+-- LATERAL JSON_TABLE calls over repeated documents give the same results
+-- whether or not they are served from the cache
+CREATE TABLE rc_docs (id int, js jsonb);
+INSERT INTO rc_docs
+SELECT i, jsonb_build_object('a', i % 3, 'b', jsonb_build_array(i % 3, i % 3 + 1))
+FROM generate_series(1, 30) i;
+ANALYZE rc_docs;
+
+SELECT js->>'a' AS a, jt.b, count(*)
+FROM rc_docs, JSON_TABLE(js, '$.b[*]' COLUMNS (b int PATH '$')) jt
+GROUP BY 1, 2 ORDER BY 1, 2;
+
+SELECT explain_resultcache('
+SELECT COUNT(*), SUM(jt.b)
+FROM rc_docs, JSON_TABLE(js, ''$.b[*]'' COLUMNS (b int PATH ''$'')) jt;', false);
+
+SET enable_resultcache TO off;
+
+SELECT js->>'a' AS a, jt.b, count(*)
+FROM rc_docs, JSON_TABLE(js, '$.b[*]' COLUMNS (b int PATH '$')) jt
+GROUP BY 1, 2 ORDER BY 1, 2;
+
+DROP TABLE rc_docs;
+
+SET enable_resultcache TO on;
+
+-- Lateral references are compared by their binary images, since the inner
+-- side may tell apart values that are equal by their type's equality
+-- operator, such as the numbers 1.0 and 1.00 in these documents
+CREATE TABLE rc_nums (id int, js jsonb);
+INSERT INTO rc_nums
+SELECT i, CASE WHEN i % 2 = 0 THEN '{"a": 1.0}' ELSE '{"a": 1.00}' END::jsonb
+FROM generate_series(1, 20) i;
+ANALYZE rc_nums;
+
+SELECT explain_resultcache('
+SELECT COUNT(DISTINCT jt.a)
+FROM rc_nums, JSON_TABLE(js, ''$'' COLUMNS (a text PATH ''$.a'')) jt;', false);
+
+SELECT jt.a, count(*)
+FROM rc_nums, JSON_TABLE(js, '$' COLUMNS (a text PATH '$.a')) jt
+GROUP BY 1 ORDER BY 1;
+
+DROP TABLE rc_nums;
+
+-- Ensure a cache entry that does not fit in work_mem puts the node into
+-- bypass mode
+SET work_mem TO '64kB';
+CREATE TABLE rc_big (n int);
+INSERT INTO rc_big SELECT 5000 FROM generate_series(1, 10);
+ANALYZE rc_big;
+
+SELECT explain_resultcache('
+SELECT COUNT(*), SUM(g) FROM rc_big, LATERAL generate_series(1, rc_big.n) g;', false);
+
+-- And check we get the expected results.
+SELECT COUNT(*), SUM(g) FROM rc_big, LATERAL generate_series(1, rc_big.n) g;
+
+RESET work_mem;
+DROP TABLE rc_big;
+DROP FUNCTION explain_resultcache(text, bool);
+RESET enable_resultcache;
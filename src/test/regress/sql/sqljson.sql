@@ -16,28 +16,30 @@ SELECT JSON('{"a": 1, "a": 2}');
 SELECT JSON('{"a": 1, "a": 2}' WITH UNIQUE KEYS);
 SELECT JSON('{"a": 1, "a": 2}' WITHOUT UNIQUE KEYS);
 
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON('123');
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON('123' FORMAT JSON);
+CREATE TABLE test_json_ctor_args (t text, i int);
+
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON(t) FROM test_json_ctor_args;
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON(t FORMAT JSON) FROM test_json_ctor_args;
 EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON('123'::bytea FORMAT JSON);
 EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON('123'::bytea FORMAT JSON ENCODING UTF8);
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON('123' WITH UNIQUE KEYS);
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON('123' WITHOUT UNIQUE KEYS);
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON(t WITH UNIQUE KEYS) FROM test_json_ctor_args;
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON(t WITHOUT UNIQUE KEYS) FROM test_json_ctor_args;
 
 SELECT JSON('123' RETURNING text);
 
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON('123');
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON('123' RETURNING json);
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON('123' RETURNING jsonb);
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON(t) FROM test_json_ctor_args;
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON(t RETURNING json) FROM test_json_ctor_args;
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON(t RETURNING jsonb) FROM test_json_ctor_args;
 SELECT pg_typeof(JSON('123'));
 SELECT pg_typeof(JSON('123' RETURNING json));
 SELECT pg_typeof(JSON('123' RETURNING jsonb));
 
 SET sql_json = jsonb;
 
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON('123');
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON('123' RETURNING json);
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON('123' RETURNING jsonb);
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON('123' RETURNING json text);
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON(t) FROM test_json_ctor_args;
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON(t RETURNING json) FROM test_json_ctor_args;
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON(t RETURNING jsonb) FROM test_json_ctor_args;
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON(t RETURNING json text) FROM test_json_ctor_args;
 SELECT pg_typeof(JSON('123'));
 SELECT pg_typeof(JSON('123' RETURNING json));
 SELECT pg_typeof(JSON('123' RETURNING jsonb));
@@ -60,17 +62,17 @@ SELECT JSON_SCALAR('2020-06-07 01:02:03'::timestamp);
 SELECT JSON_SCALAR('{}'::json);
 SELECT JSON_SCALAR('{}'::jsonb);
 
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR(123);
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR('123');
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR(123 RETURNING json);
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR(123 RETURNING jsonb);
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR(i) FROM test_json_ctor_args;
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR(t) FROM test_json_ctor_args;
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR(i RETURNING json) FROM test_json_ctor_args;
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR(i RETURNING jsonb) FROM test_json_ctor_args;
 
 SET sql_json = jsonb;
 
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR(123);
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR(123 RETURNING json);
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR(123 RETURNING jsonb);
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR(123 RETURNING json text);
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR(i) FROM test_json_ctor_args;
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR(i RETURNING json) FROM test_json_ctor_args;
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR(i RETURNING jsonb) FROM test_json_ctor_args;
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR(i RETURNING json text) FROM test_json_ctor_args;
 
 SET sql_json = json;
 
@@ -84,7 +86,7 @@ SELECT JSON_SERIALIZE('1' FORMAT JSON);
 SELECT JSON_SERIALIZE('{ "a" : 1 } ' RETURNING bytea);
 SELECT pg_typeof(JSON_SERIALIZE(NULL));
 
-EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SERIALIZE('{}');
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SERIALIZE(t) FROM test_json_ctor_args;
 EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SERIALIZE('{}' RETURNING bytea);
 
 -- JSON_OBJECT()
@@ -261,6 +263,15 @@ SELECT
 FROM
 	(VALUES (NULL), (3), (1), (NULL), (NULL), (5), (2), (4), (NULL), (5), (4)) foo(bar);
 
+-- Moving-aggregate mode
+SELECT
+	i, v,
+	JSON_ARRAYAGG(v) OVER w AS absent,
+	JSON_ARRAYAGG(v NULL ON NULL RETURNING jsonb) OVER w AS "null"
+FROM
+	(VALUES (1, 1), (2, NULL), (3, 3), (4, NULL), (5, NULL), (6, 6)) foo(i, v)
+WINDOW w AS (ORDER BY i ROWS 2 PRECEDING);
+
 -- JSON_OBJECTAGG()
 SELECT	JSON_OBJECTAGG('key': 1) IS NULL,
 		JSON_OBJECTAGG('key': 1 RETURNING jsonb) IS NULL
@@ -305,7 +316,7 @@ FROM (VALUES (1, 1), (1, NULL), (2, 2)) foo(k, v);
 
 -- Test JSON_OBJECT deparsing
 EXPLAIN (VERBOSE, COSTS OFF)
-SELECT JSON_OBJECT('foo' : '1' FORMAT JSON, 'bar' : 'baz' RETURNING json);
+SELECT JSON_OBJECT('foo' : t FORMAT JSON, 'bar' : t RETURNING json) FROM test_json_ctor_args;
 
 CREATE VIEW json_object_view AS
 SELECT JSON_OBJECT('foo' : '1' FORMAT JSON, 'bar' : 'baz' RETURNING json);
@@ -316,7 +327,7 @@ DROP VIEW json_object_view;
 
 -- Test JSON_ARRAY deparsing
 EXPLAIN (VERBOSE, COSTS OFF)
-SELECT JSON_ARRAY('1' FORMAT JSON, 2 RETURNING json);
+SELECT JSON_ARRAY(t FORMAT JSON, i RETURNING json) FROM test_json_ctor_args;
 
 CREATE VIEW json_array_view AS
 SELECT JSON_ARRAY('1' FORMAT JSON, 2 RETURNING json);
@@ -325,6 +336,28 @@ SELECT JSON_ARRAY('1' FORMAT JSON, 2 RETURNING json);
 
 DROP VIEW json_array_view;
 
+DROP TABLE test_json_ctor_args;
+
+-- Test plan-time folding of constructors with constant arguments
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON('123');
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON('123' WITH UNIQUE KEYS);
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON('123' RETURNING jsonb);
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR(123);
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR('123');
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR(123 RETURNING jsonb);
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SERIALIZE('{}');
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT JSON_OBJECT('foo' : '1' FORMAT JSON, 'bar' : 'baz' RETURNING json);
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT JSON_ARRAY('1' FORMAT JSON, 2 RETURNING json);
+
+SET sql_json = jsonb;
+
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON('123' RETURNING json text);
+EXPLAIN (VERBOSE, COSTS OFF) SELECT JSON_SCALAR(123 RETURNING json text);
+
+SET sql_json = json;
+
 -- Test JSON_OBJECTAGG deparsing
 EXPLAIN (VERBOSE, COSTS OFF)
 SELECT JSON_OBJECTAGG(i: ('111' || i)::bytea FORMAT JSON WITH UNIQUE RETURNING text) FILTER (WHERE i > 3)
@@ -455,6 +488,27 @@ SELECT
 FROM
 	(SELECT js::jsonb FROM test_is_json WHERE js IS JSON) foo(js);
 
+-- Key uniqueness is checked per object
+SELECT js, js IS JSON WITH UNIQUE KEYS "WITH UNIQUE"
+FROM (VALUES
+	('[{"a": 1, "b": 2}, {"a": 3, "b": 4}]'),
+	('{"a": {"b": 1}, "b": {"a": 1, "b": 2}}'),
+	('{"a": {"b": 1, "c": {}}, "c": 1, "a": 2}'),
+	('{"\u0061": 1, "a": 2}')
+) t(js);
+
+SELECT ('{' || string_agg(format('"k%s": %s', i, i), ', ') || '}') IS JSON WITH UNIQUE KEYS
+FROM generate_series(1, 2000) i;
+
+SELECT ('{' || string_agg(format('"k%s": %s', i % 2000, i), ', ') || '}') IS JSON WITH UNIQUE KEYS
+FROM generate_series(1, 2001) i;
+
+SELECT length(JSON_OBJECTAGG(('k' || i % 1000) : i WITH UNIQUE KEYS)::text)
+FROM generate_series(1, 1000) i;
+
+SELECT JSON_OBJECTAGG(('k' || i % 1000) : i WITH UNIQUE KEYS)
+FROM generate_series(1, 1001) i;
+
 -- Test IS JSON deparsing
 EXPLAIN (VERBOSE, COSTS OFF)
 SELECT '1' IS JSON AS "any", ('1' || i) IS JSON SCALAR AS "scalar", '[]' IS NOT JSON ARRAY AS "array", '{}' IS JSON OBJECT WITH UNIQUE AS "object" FROM generate_series(1, 3) i;